@@ -1,44 +1,23 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
-#include <zephyr/drivers/adc.h>
-#include <nrfx_saadc.h> // Для доступа к калибровке
-
-// Получаем устройство ADC
-#define ADC_NODE DT_NODELABEL(adc)
-static const struct device *adc_dev = DEVICE_DT_GET(ADC_NODE);
-
-// Настройки канала (должны совпадать с Device Tree)
-#define ADC_CHANNEL_ID 5
-#define ADC_RESOLUTION 12 // 12-bit разрешение
-#define ADC_GAIN ADC_GAIN_1_6
-#define ADC_REFERENCE ADC_REF_INTERNAL
-#define ADC_ACQUISITION_TIME ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 5)
-
-// Буфер для хранения результата
-static int16_t sample_buffer;
-
-// Конфигурация канала
-static struct adc_channel_cfg channel_cfg = {
-    .gain = ADC_GAIN,
-    .reference = ADC_REFERENCE,
-    .acquisition_time = ADC_ACQUISITION_TIME,
-    .channel_id = ADC_CHANNEL_ID,
-    .differential = 0};
-
-// Конфигурация последовательности чтения
-static struct adc_sequence sequence = {
-    .channels = BIT(ADC_CHANNEL_ID),
-    .buffer = &sample_buffer,
-    .buffer_size = sizeof(sample_buffer),
-    .resolution = ADC_RESOLUTION,
-};
-
-#include <zephyr/kernel.h>
-#include <zephyr/device.h>
-#include <zephyr/drivers/adc.h>
+#include <zephyr/irq.h>
 #include <hal/nrf_saadc.h>
+#include <helpers/nrfx_gppi.h>
+
+#include "adc.h"
+#include "sample_ring.h"
+#include "pwm_sync.h"
+
+#define ADC_DMA_REGS NRF_SAADC_Type
+#include "adc_dma.h"
+
+/*
+ * SAADC управляется напрямую через регистры, драйвер Zephyr ADC отключён
+ * (CONFIG_ADC=n), поэтому прерывание SAADC принадлежит этому файлу.
+ */
 
-// ... ваши определения ...
+// Поправка к сырому результату (подобрана по эталонному напряжению)
+#define ADC_RESULT_OFFSET 2
 
 /**
  * @brief Калибровка SAADC через регистры
@@ -72,24 +51,32 @@ void adc_setup_registers(void)
 {
     NRF_SAADC_Type *saadc = NRF_SAADC;
 
-    printk("Configuring SAADC via registers (14-bit oversampled)...\n");
+    printk("Configuring SAADC via registers (%d channels, 14-bit oversampled)...\n",
+           ADC_CHANNEL_COUNT);
 
     // 1. Включаем SAADC
     saadc->ENABLE = (SAADC_ENABLE_ENABLE_Enabled << SAADC_ENABLE_ENABLE_Pos);
 
-    // 2. Настройка канала 5
-    saadc->CH[5].CONFIG =
-        (SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos) |
-        (SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) |
-        (SAADC_CH_CONFIG_GAIN_Gain1_5 << SAADC_CH_CONFIG_GAIN_Pos) |
-        (SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos) |
-        (SAADC_CH_CONFIG_TACQ_40us << SAADC_CH_CONFIG_TACQ_Pos) |
-        (SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos) |
-        (SAADC_CH_CONFIG_BURST_Enabled << SAADC_CH_CONFIG_BURST_Pos);
+    // 2. Каналы из таблицы ADC_CHANNELS, остальные слоты отключены
+    for (int i = 0; i < SAADC_CH_NUM; i++)
+    {
+        saadc->CH[i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+        saadc->CH[i].PSELN = SAADC_CH_PSELN_PSELN_NC;
+    }
 
-    // 3. Пины — AIN5
-    saadc->CH[5].PSELP = SAADC_CH_PSELP_PSELP_AnalogInput5;
-    saadc->CH[5].PSELN = SAADC_CH_PSELN_PSELN_NC;
+    // 3. BURST на всех каналах обязателен для oversample в режиме скана
+#define ADC_CH_SETUP(name, pselp, gain, tacq)                                       \
+    saadc->CH[ADC_CH_##name].CONFIG =                                               \
+        (SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos) |                 \
+        (SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) |                 \
+        (SAADC_CH_CONFIG_GAIN_##gain << SAADC_CH_CONFIG_GAIN_Pos) |                 \
+        (SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos) |           \
+        (SAADC_CH_CONFIG_TACQ_##tacq##us << SAADC_CH_CONFIG_TACQ_Pos) |             \
+        (SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos) |                     \
+        (SAADC_CH_CONFIG_BURST_Enabled << SAADC_CH_CONFIG_BURST_Pos);               \
+    saadc->CH[ADC_CH_##name].PSELP = pselp;
+    ADC_CHANNELS(ADC_CH_SETUP)
+#undef ADC_CH_SETUP
 
     // 4. Физическое разрешение = 12 бит
     saadc->RESOLUTION =
@@ -111,13 +98,637 @@ void adc_setup_registers(void)
     k_sleep(K_MSEC(5));
 }
 
+// ==================== Потоковый режим (EasyDMA + TIMER + PPI) ====================
+/*
+ * TIMER2 по COMPARE[0] через PPI запускает SAMPLE, SAADC END через PPI
+ * перезапускает START. Прерывание только на STARTED (подставить следующий
+ * буфер) и END (отдать заполненный буфер). Процессор спит между буферами.
+ *
+ * Один SAMPLE сканирует все каналы таблицы, DMA пишет их вперемешку:
+ * [ch0 ch1 .. chN-1][ch0 ch1 .. chN-1]... В ISR буфер раскладывается
+ * в adc_frame_t (struct-of-arrays).
+ *
+ * Период таймера не должен быть меньше времени скана ADC_SCAN_TIME_US.
+ *
+ * От ADC_SCAN_RTC_MIN_US (скан в простое) SAMPLE даёт k_timer на системных
+ * часах RTC вместо TIMER2: между сканами не работают ни таймер, ни HFCLK.
+ */
+#define ADC_STREAM_TIMER NRF_TIMER2
+#define ADC_STREAM_BUF_LEN (ADC_FRAME_LEN * ADC_CHANNEL_COUNT)
+#define ADC_STREAM_MIN_PERIOD_US (ADC_SCAN_TIME_US + 1000)
+#define ADC_STREAM_RING_CH ADC_CH_BATTERY // канал, который идёт в кольцо
+
+// Синхронный с ШИМ режим: TIMER3 16 МГц, скан CURRENT + MOTOR_V
+#define ADC_SYNC_TIMER NRF_TIMER3
+#define ADC_SYNC_PWM NRF_PWM0
+#define ADC_SYNC_SCAN_LEN 2                        // каналов в скане
+#define ADC_SYNC_BUF_LEN (ADC_SYNC_FRAME_LEN * 2 * ADC_SYNC_SCAN_LEN)
+#define ADC_SYNC_CONV_US 2                         // преобразование одного канала
+#define ADC_SYNC_BLANK_US 2                        // гашение после фронта ключа
+
+#define ADC_DMA_BUF_LEN MAX(ADC_STREAM_BUF_LEN, ADC_SYNC_BUF_LEN)
+#define ADC_PPI_MAX 4
+
+enum adc_mode
+{
+    ADC_MODE_IDLE,
+    ADC_MODE_SCAN,     // скан всех каналов по TIMER2
+    ADC_MODE_PWM_SYNC, // выборка по периоду ШИМ
+};
+
+static struct
+{
+    int16_t buf[2][ADC_DMA_BUF_LEN]; // двойной буфер EasyDMA
+    adc_dma_t dma;                   // смена буферов (adc_dma.h)
+    enum adc_mode mode;
+    uint8_t ppi[ADC_PPI_MAX];
+    uint8_t ppi_count;
+    adc_stream_cb_t cb;
+    uint32_t period_us;              // период скана, 0 - не запущен
+    adc_frame_t frame[2];            // разобранные кадры
+    uint8_t published;               // последний готовый кадр
+    sample_ring_t ring;
+    int16_t last;
+
+    adc_sync_cb_t sync_cb;
+    adc_sync_frame_t sync_frame[2];
+    bool sync_bemf;                  // второй SAMPLE в выключенном состоянии
+    pwm_sync_timing_t sync_timing;
+
+    struct k_event *notify;          // событие о готовом кадре скана
+    uint32_t notify_events;
+} adc_stream;
+
+K_SEM_DEFINE(adc_stream_sem, 0, 1);
+
+// Редкий скан: SAMPLE из обработчика k_timer (RTC)
+static void adc_stream_tick(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+    NRF_SAADC->TASKS_SAMPLE = 1;
+}
+
+K_TIMER_DEFINE(adc_stream_rtc, adc_stream_tick, NULL);
+
 /**
- * @brief Чтение ADC через регистры (пример)
+ * @brief Разложить чередующийся DMA буфер по каналам
  */
-int16_t adc_read_registers(void)
+static void adc_demux(adc_frame_t *frame, const int16_t *src, uint32_t amount)
+{
+    uint16_t scans = amount / ADC_CHANNEL_COUNT;
+
+    for (uint16_t s = 0; s < scans; s++)
+    {
+        for (int c = 0; c < ADC_CHANNEL_COUNT; c++)
+        {
+            frame->ch[c][s] = *src++ + ADC_RESULT_OFFSET;
+        }
+    }
+
+    frame->count = scans;
+}
+
+/**
+ * @brief Разложить буфер синхронного режима: на период один или два скана
+ * [CURRENT MOTOR_V] (включённое состояние) [CURRENT MOTOR_V] (пауза)
+ */
+static void adc_sync_demux(adc_sync_frame_t *frame, const int16_t *src, uint32_t amount)
+{
+    uint32_t per_period = ADC_SYNC_SCAN_LEN * (adc_stream.sync_bemf ? 2 : 1);
+    uint16_t periods = amount / per_period;
+
+    for (uint16_t p = 0; p < periods; p++)
+    {
+        frame->current[p] = src[0] + ADC_RESULT_OFFSET;
+        frame->bemf[p] = adc_stream.sync_bemf ? src[ADC_SYNC_SCAN_LEN + 1] + ADC_RESULT_OFFSET : 0;
+        src += per_period;
+    }
+
+    frame->count = periods;
+    frame->current_valid = adc_stream.sync_timing.on_valid;
+    frame->bemf_valid = adc_stream.sync_bemf && adc_stream.sync_timing.off_valid;
+}
+
+static void adc_deliver(const int16_t *done, uint32_t amount)
+{
+    uint8_t idx = adc_stream.published ^ 1;
+
+    if (adc_stream.mode == ADC_MODE_PWM_SYNC)
+    {
+        adc_sync_frame_t *frame = &adc_stream.sync_frame[idx];
+        adc_sync_demux(frame, done, amount);
+        adc_stream.published = idx;
+
+        if (adc_stream.sync_cb)
+        {
+            adc_stream.sync_cb(frame);
+        }
+        return;
+    }
+
+    adc_frame_t *frame = &adc_stream.frame[idx];
+    adc_demux(frame, done, amount);
+    adc_stream.published = idx;
+
+    if (frame->count)
+    {
+        adc_stream.last = frame->ch[ADC_STREAM_RING_CH][frame->count - 1];
+    }
+
+    if (adc_stream.cb)
+    {
+        adc_stream.cb(frame);
+    }
+    else
+    {
+        sample_ring_put(&adc_stream.ring, frame->ch[ADC_STREAM_RING_CH], frame->count);
+    }
+}
+
+// Смена буферов - в adc_dma.h (проверяется на хосте), здесь только доставка
+static void adc_stream_isr(const void *arg)
+{
+    uint32_t amount;
+
+    ARG_UNUSED(arg);
+
+    const int16_t *done = adc_dma_irq(&adc_stream.dma, NRF_SAADC, &amount);
+    if (!done)
+    {
+        return;
+    }
+
+    adc_deliver(done, amount);
+    k_sem_give(&adc_stream_sem);
+
+    if (adc_stream.notify && adc_stream.mode == ADC_MODE_SCAN)
+    {
+        k_event_post(adc_stream.notify, adc_stream.notify_events);
+    }
+}
+
+static int adc_ppi_connect(uint32_t eep, uint32_t tep)
+{
+    uint8_t ch;
+
+    if (adc_stream.ppi_count >= ADC_PPI_MAX ||
+        nrfx_gppi_channel_alloc(&ch) != NRFX_SUCCESS)
+    {
+        return -ENOMEM;
+    }
+
+    nrfx_gppi_channel_endpoints_setup(ch, eep, tep);
+    adc_stream.ppi[adc_stream.ppi_count++] = ch;
+    return ch;
+}
+
+static void adc_ppi_release(void)
+{
+    for (uint8_t i = 0; i < adc_stream.ppi_count; i++)
+    {
+        nrfx_gppi_channels_disable(BIT(adc_stream.ppi[i]));
+        nrfx_gppi_channel_free(adc_stream.ppi[i]);
+    }
+    adc_stream.ppi_count = 0;
+}
+
+/**
+ * @brief Запустить цепочку SAADC: trigger -> SAMPLE, END -> START
+ * @param trigger_eep Событие для SAMPLE, 0 - SAMPLE запускается программно
+ */
+static int adc_dma_begin(enum adc_mode mode, uint32_t trigger_eep, uint16_t maxcnt)
+{
+    NRF_SAADC_Type *saadc = NRF_SAADC;
+    uint32_t mask = 0;
+    int ch;
+
+    if (trigger_eep)
+    {
+        ch = adc_ppi_connect(trigger_eep, (uint32_t)&saadc->TASKS_SAMPLE);
+        if (ch < 0)
+        {
+            return ch;
+        }
+        mask |= BIT(ch);
+    }
+
+    ch = adc_ppi_connect((uint32_t)&saadc->EVENTS_END, (uint32_t)&saadc->TASKS_START);
+    if (ch < 0)
+    {
+        adc_ppi_release();
+        return ch;
+    }
+    mask |= BIT(ch);
+
+    adc_dma_reset(&adc_stream.dma, adc_stream.buf[0], adc_stream.buf[1]);
+    adc_stream.published = 0;
+    adc_stream.frame[0].count = 0;
+    adc_stream.sync_frame[0].count = 0;
+    sample_ring_reset(&adc_stream.ring);
+
+    saadc->EVENTS_STARTED = 0;
+    saadc->EVENTS_END = 0;
+    saadc->EVENTS_STOPPED = 0;
+    saadc->RESULT.PTR = (uint32_t)adc_stream.buf[0];
+    saadc->RESULT.MAXCNT = maxcnt;
+    saadc->INTENSET = SAADC_INTENSET_STARTED_Msk | SAADC_INTENSET_END_Msk;
+
+    adc_stream.mode = mode;
+    nrfx_gppi_channels_enable(mask);
+    saadc->TASKS_START = 1;
+
+    return 0;
+}
+
+static void adc_dma_end(void)
 {
     NRF_SAADC_Type *saadc = NRF_SAADC;
-    volatile int16_t result;
+
+    adc_ppi_release();
+
+    saadc->INTENCLR = SAADC_INTENCLR_STARTED_Msk | SAADC_INTENCLR_END_Msk;
+    saadc->TASKS_STOP = 1;
+    while (saadc->EVENTS_STOPPED == 0)
+        ;
+    saadc->EVENTS_STOPPED = 0;
+    saadc->EVENTS_STARTED = 0;
+    saadc->EVENTS_END = 0;
+
+    adc_stream.mode = ADC_MODE_IDLE;
+}
+
+/**
+ * @brief Запустить непрерывную выборку по таймеру
+ * @param period_us Период выборки, мкс
+ * @param cb Обработчик кадра (вызывается из ISR) или NULL - тогда в кольцо
+ * @return 0 при успехе, отрицательное значение при ошибке
+ */
+int adc_stream_start(uint32_t period_us, adc_stream_cb_t cb)
+{
+    NRF_TIMER_Type *timer = ADC_STREAM_TIMER;
+    int err;
+
+    if (adc_stream.mode != ADC_MODE_IDLE)
+    {
+        return -EALREADY;
+    }
+
+    if (period_us < ADC_STREAM_MIN_PERIOD_US)
+    {
+        return -EINVAL;
+    }
+
+    adc_stream.cb = cb;
+
+    if (period_us >= ADC_SCAN_RTC_MIN_US)
+    {
+        err = adc_dma_begin(ADC_MODE_SCAN, 0, ADC_STREAM_BUF_LEN);
+        if (err)
+        {
+            return err;
+        }
+        adc_stream.period_us = period_us;
+        k_timer_start(&adc_stream_rtc, K_USEC(period_us), K_USEC(period_us));
+        return 0;
+    }
+
+    // Таймер 1 МГц, сброс по COMPARE[0]
+    timer->TASKS_STOP = 1;
+    timer->MODE = TIMER_MODE_MODE_Timer;
+    timer->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    timer->PRESCALER = 4; // 16 МГц / 2^4
+    timer->CC[0] = period_us;
+    timer->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    timer->TASKS_CLEAR = 1;
+
+    err = adc_dma_begin(ADC_MODE_SCAN, (uint32_t)&timer->EVENTS_COMPARE[0],
+                        ADC_STREAM_BUF_LEN);
+    if (err)
+    {
+        return err;
+    }
+
+    adc_stream.period_us = period_us;
+    timer->TASKS_START = 1;
+    return 0;
+}
+
+/**
+ * @brief Остановить непрерывную выборку
+ */
+void adc_stream_stop(void)
+{
+    if (adc_stream.mode != ADC_MODE_SCAN)
+    {
+        return;
+    }
+
+    k_timer_stop(&adc_stream_rtc);
+    ADC_STREAM_TIMER->TASKS_STOP = 1;
+    adc_dma_end();
+    adc_stream.period_us = 0;
+}
+
+/**
+ * @brief Сменить период фонового скана, если скан идёт
+ *
+ * Пока ADC в синхронном с ШИМ режиме, ничего не делает: скан запустит
+ * тот, кто из него выходит.
+ * @return 0, -EBUSY в синхронном режиме, ошибка adc_stream_start()
+ */
+int adc_stream_set_period(uint32_t period_us)
+{
+    if (adc_stream.mode == ADC_MODE_PWM_SYNC)
+    {
+        return -EBUSY;
+    }
+    if (adc_stream.mode == ADC_MODE_SCAN && adc_stream.period_us == period_us)
+    {
+        return 0;
+    }
+
+    adc_stream_stop();
+    return adc_stream_start(period_us, adc_stream.cb);
+}
+
+/**
+ * @brief Выставлять события на каждый готовый кадр скана
+ *
+ * Сохраняется между adc_stream_start()/adc_stream_stop(), в синхронном
+ * режиме не выставляется.
+ */
+void adc_stream_notify(struct k_event *event, uint32_t events)
+{
+    adc_stream.notify_events = events;
+    adc_stream.notify = event;
+}
+
+/**
+ * @brief Забрать накопленные отсчёты канала ADC_STREAM_RING_CH из кольца
+ * @return количество прочитанных отсчётов
+ */
+size_t adc_stream_read(int16_t *dst, size_t max)
+{
+    return sample_ring_get(&adc_stream.ring, dst, max);
+}
+
+/**
+ * @brief Ждать следующего заполненного буфера
+ * @return 0 если буфер пришёл, -EAGAIN по таймауту
+ */
+int adc_stream_wait(k_timeout_t timeout)
+{
+    return k_sem_take(&adc_stream_sem, timeout);
+}
+
+/**
+ * @brief Последний разобранный кадр всех каналов
+ *
+ * Кадр не перезаписывается до следующего END, т.е. минимум один период буфера.
+ */
+const adc_frame_t *adc_stream_frame(void)
+{
+    return &adc_stream.frame[adc_stream.published];
+}
+
+// Отсчёты канала кольца, потерянные из-за переполнения кольца или пропущенной смены буфера DMA
+uint32_t adc_stream_overruns(void)
+{
+    return adc_stream.ring.overruns + adc_stream.dma.missed * ADC_FRAME_LEN;
+}
+
+// ==================== Синхронная с ШИМ выборка ====================
+#define ADC_CH_TACQ(name, pselp, gain, tacq) [ADC_CH_##name] = (tacq),
+static const uint8_t adc_tacq_us[ADC_CHANNEL_COUNT] = {ADC_CHANNELS(ADC_CH_TACQ)};
+#undef ADC_CH_TACQ
+
+static uint32_t adc_sync_period_ticks;
+static uint32_t adc_sync_pulse_ticks;
+static pwm_sync_timing_t adc_sync_pending; // CC, ждущие последнего COMPARE периода
+
+/**
+ * @brief Оставить в скане только CURRENT и MOTOR_V, без oversample и BURST
+ */
+static void adc_sync_setup_registers(void)
+{
+    NRF_SAADC_Type *saadc = NRF_SAADC;
+
+    for (int i = 0; i < ADC_CHANNEL_COUNT; i++)
+    {
+        if (i != ADC_CH_CURRENT && i != ADC_CH_MOTOR_V)
+        {
+            saadc->CH[i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+        }
+    }
+
+    saadc->CH[ADC_CH_CURRENT].CONFIG &= ~SAADC_CH_CONFIG_BURST_Msk;
+    saadc->CH[ADC_CH_MOTOR_V].CONFIG &= ~SAADC_CH_CONFIG_BURST_Msk;
+
+    saadc->OVERSAMPLE =
+        (SAADC_OVERSAMPLE_OVERSAMPLE_Bypass << SAADC_OVERSAMPLE_OVERSAMPLE_Pos);
+}
+
+static pwm_sync_timing_t adc_sync_calc(void)
+{
+    uint32_t on_conv = adc_tacq_us[ADC_CH_CURRENT] + ADC_SYNC_CONV_US;
+    uint32_t off_conv = adc_tacq_us[ADC_CH_MOTOR_V] + ADC_SYNC_CONV_US;
+
+    pwm_sync_params_t p = {
+        .period = adc_sync_period_ticks,
+        .pulse = adc_sync_pulse_ticks,
+        .on_lead = 0,
+        .on_acq = PWM_SYNC_US_TO_TICKS(adc_tacq_us[ADC_CH_CURRENT]),
+        .off_lead = PWM_SYNC_US_TO_TICKS(on_conv),
+        .off_acq = PWM_SYNC_US_TO_TICKS(adc_tacq_us[ADC_CH_MOTOR_V]),
+        .scan = PWM_SYNC_US_TO_TICKS(on_conv + off_conv),
+        .blank = PWM_SYNC_US_TO_TICKS(ADC_SYNC_BLANK_US),
+    };
+
+    return pwm_sync_calc(&p);
+}
+
+static inline uint8_t adc_sync_last_cc(void)
+{
+    return adc_stream.sync_bemf ? 1 : 0;
+}
+
+static void adc_sync_write_cc(const pwm_sync_timing_t *t)
+{
+    ADC_SYNC_TIMER->CC[0] = t->on_cc;
+    ADC_SYNC_TIMER->CC[1] = t->off_cc;
+    adc_stream.sync_timing = *t;
+}
+
+/**
+ * @brief Последний COMPARE периода: отложенные CC вступают в силу
+ *
+ * До следующего PWMPERIODEND TIMER3 стоит, SAMPLE этого периода уже все.
+ */
+static void adc_sync_timer_isr(const void *arg)
+{
+    NRF_TIMER_Type *timer = ADC_SYNC_TIMER;
+    uint8_t last = adc_sync_last_cc();
+
+    ARG_UNUSED(arg);
+
+    timer->EVENTS_COMPARE[last] = 0;
+    timer->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk << last;
+    adc_sync_write_cc(&adc_sync_pending);
+}
+
+/**
+ * @brief Записать новые CC в TIMER3
+ *
+ * TIMER3 останавливается по последнему COMPARE периода. Менять CC безопасно
+ * только после него, иначе в текущем периоде можно пропустить SAMPLE
+ * и навсегда сдвинуть раскладку DMA буфера. Если период ещё идёт, CC
+ * пишет прерывание по последнему COMPARE: без ожидания при любой частоте ШИМ.
+ */
+static void adc_sync_apply(void)
+{
+    NRF_TIMER_Type *timer = ADC_SYNC_TIMER;
+    pwm_sync_timing_t t = adc_sync_calc();
+    uint8_t last = adc_sync_last_cc();
+    unsigned int key = irq_lock();
+
+    timer->TASKS_CAPTURE[2] = 1;
+    if (timer->CC[2] >= timer->CC[last])
+    {
+        // Период уже отработал или ШИМ стоит
+        timer->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk << last;
+        adc_sync_write_cc(&t);
+    }
+    else
+    {
+        adc_sync_pending = t;
+        timer->EVENTS_COMPARE[last] = 0;
+        timer->INTENSET = TIMER_INTENSET_COMPARE0_Msk << last;
+    }
+    irq_unlock(key);
+}
+
+/**
+ * @brief Сообщить текущие период и длительность импульса ШИМ
+ *
+ * Вызывается из motor_set_pwm(), в синхронном режиме сразу пересчитывает CC.
+ */
+void adc_sync_set_pwm(uint32_t period_ns, uint32_t pulse_ns)
+{
+    adc_sync_period_ticks = PWM_SYNC_NS_TO_TICKS(period_ns);
+    adc_sync_pulse_ticks = PWM_SYNC_NS_TO_TICKS(pulse_ns);
+
+    if (adc_stream.mode == ADC_MODE_PWM_SYNC)
+    {
+        adc_sync_apply();
+    }
+}
+
+/**
+ * @brief Запустить выборку по периоду ШИМ
+ * @param bemf Дополнительный SAMPLE в середине выключенного состояния (ЭДС)
+ * @param cb Обработчик кадра (вызывается из ISR) или NULL
+ * @return 0 при успехе, отрицательное значение при ошибке
+ */
+int adc_sync_start(bool bemf, adc_sync_cb_t cb)
+{
+    NRF_TIMER_Type *timer = ADC_SYNC_TIMER;
+    int err;
+    int ch;
+
+    if (adc_stream.mode != ADC_MODE_IDLE)
+    {
+        return -EALREADY;
+    }
+
+    adc_stream.sync_cb = cb;
+    adc_stream.sync_bemf = bemf;
+
+    adc_sync_setup_registers();
+
+    // TIMER3 16 МГц: стартует с начала периода ШИМ, стоп на последнем SAMPLE
+    timer->TASKS_STOP = 1;
+    timer->MODE = TIMER_MODE_MODE_Timer;
+    timer->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    timer->PRESCALER = 0;
+    timer->SHORTS = bemf ? TIMER_SHORTS_COMPARE1_STOP_Msk : TIMER_SHORTS_COMPARE0_STOP_Msk;
+    timer->TASKS_CLEAR = 1;
+
+    adc_stream.sync_timing = adc_sync_calc();
+    timer->CC[0] = adc_stream.sync_timing.on_cc;
+    timer->CC[1] = adc_stream.sync_timing.off_cc;
+
+    err = adc_dma_begin(ADC_MODE_PWM_SYNC, (uint32_t)&timer->EVENTS_COMPARE[0],
+                        ADC_SYNC_FRAME_LEN * ADC_SYNC_SCAN_LEN * (bemf ? 2 : 1));
+    if (err)
+    {
+        adc_setup_registers();
+        return err;
+    }
+
+    if (bemf)
+    {
+        ch = adc_ppi_connect((uint32_t)&timer->EVENTS_COMPARE[1],
+                             (uint32_t)&NRF_SAADC->TASKS_SAMPLE);
+        if (ch < 0)
+        {
+            adc_sync_stop();
+            return ch;
+        }
+        nrfx_gppi_channels_enable(BIT(ch));
+    }
+
+    // PWMPERIODEND -> TIMER3 CLEAR + START
+    ch = adc_ppi_connect((uint32_t)&ADC_SYNC_PWM->EVENTS_PWMPERIODEND,
+                         (uint32_t)&timer->TASKS_CLEAR);
+    if (ch < 0)
+    {
+        adc_sync_stop();
+        return ch;
+    }
+    nrfx_gppi_fork_endpoint_setup(ch, (uint32_t)&timer->TASKS_START);
+    nrfx_gppi_channels_enable(BIT(ch));
+
+    return 0;
+}
+
+/**
+ * @brief Остановить синхронную выборку и вернуть обычную конфигурацию каналов
+ */
+void adc_sync_stop(void)
+{
+    if (adc_stream.mode != ADC_MODE_PWM_SYNC)
+    {
+        return;
+    }
+
+    adc_dma_end();
+    ADC_SYNC_TIMER->TASKS_STOP = 1;
+    ADC_SYNC_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk | TIMER_INTENCLR_COMPARE1_Msk;
+    adc_setup_registers();
+}
+
+/**
+ * @brief Последний разобранный кадр синхронного режима
+ */
+const adc_sync_frame_t *adc_sync_frame(void)
+{
+    return &adc_stream.sync_frame[adc_stream.published];
+}
+
+/**
+ * @brief Однократный скан всех каналов через регистры
+ * @param out Результат, по одному отсчёту на канал ADC_CH_x
+ * @return 0 при успехе, -EBUSY в потоковом режиме
+ */
+int adc_read_scan(int16_t out[ADC_CHANNEL_COUNT])
+{
+    NRF_SAADC_Type *saadc = NRF_SAADC;
+    volatile int16_t result[ADC_CHANNEL_COUNT];
+
+    if (adc_stream.mode != ADC_MODE_IDLE)
+    {
+        return -EBUSY;
+    }
 
     // 1. Очистить события
     saadc->EVENTS_STARTED = 0;
@@ -125,8 +736,8 @@ int16_t adc_read_registers(void)
     saadc->EVENTS_DONE = 0;
 
     // 2. Настроить буфер результата
-    saadc->RESULT.PTR = (uint32_t)&result;
-    saadc->RESULT.MAXCNT = 1;
+    saadc->RESULT.PTR = (uint32_t)result;
+    saadc->RESULT.MAXCNT = ADC_CHANNEL_COUNT;
 
     // 3. Запустить START задачу
     saadc->TASKS_START = 1;
@@ -152,34 +763,43 @@ int16_t adc_read_registers(void)
         ;
     saadc->EVENTS_STOPPED = 0;
 
-    return result + 2;
+    for (int c = 0; c < ADC_CHANNEL_COUNT; c++)
+    {
+        out[c] = result[c] + ADC_RESULT_OFFSET;
+    }
+
+    return 0;
 }
 
 /**
- * @brief Инициализация с регистрами
+ * @brief Чтение батареи через регистры
+ *
+ * В потоковом режиме не трогает SAADC и возвращает последний отсчёт.
  */
-int adc_init(void)
+int16_t adc_read_registers(void)
 {
-    // int ret;
+    int16_t scan[ADC_CHANNEL_COUNT];
 
-    // if (!device_is_ready(adc_dev)) {
-    //     printk("ADC device not ready\n");
-    //     return -1;
-    // }
+    if (adc_read_scan(scan))
+    {
+        return adc_stream.last;
+    }
 
-    // // Стандартная настройка через Zephyr API
-    // ret = adc_channel_setup(adc_dev, &channel_cfg);
-    // if (ret < 0) {
-    //     printk("ADC channel setup failed: %d\n", ret);
-    //     return ret;
-    // }
+    return scan[ADC_CH_BATTERY];
+}
 
-    // // Дополнительная калибровка через регистры
-    // adc_calibrate_registers();
+/**
+ * @brief Инициализация с регистрами
+ */
+int adc_init(void)
+{
+    adc_setup_registers();
 
-    // printk("ADC initialized with register calibration\n");
+    IRQ_CONNECT(SAADC_IRQn, 2, adc_stream_isr, NULL, 0);
+    irq_enable(SAADC_IRQn);
 
-    adc_setup_registers();
+    IRQ_CONNECT(TIMER3_IRQn, 2, adc_sync_timer_isr, NULL, 0);
+    irq_enable(TIMER3_IRQn);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,94 @@
+#ifndef ADC_H_
+#define ADC_H_
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Набор каналов SAADC объявляется один раз здесь.
+ * Позиция в таблице = номер слота CH[n] и порядок в DMA буфере скана.
+ *
+ *  имя          вход PSELP                               усиление  TACQ, мкс
+ */
+#define ADC_CHANNELS(X)                                                     \
+    X(BATTERY,    SAADC_CH_PSELP_PSELP_AnalogInput5,       Gain1_5,  40)    \
+    X(CURRENT,    SAADC_CH_PSELP_PSELP_AnalogInput1,       Gain4,    3)     \
+    X(SUPPLY,     SAADC_CH_PSELP_PSELP_VDDHDIV5,           Gain1_6,  10)    \
+    X(BOARD_TEMP, SAADC_CH_PSELP_PSELP_AnalogInput2,       Gain1_6,  40)    \
+    X(MOTOR_V,    SAADC_CH_PSELP_PSELP_AnalogInput3,       Gain1_6,  10)
+
+#define ADC_CH_ENUM(name, pselp, gain, tacq) ADC_CH_##name,
+enum adc_channel
+{
+    ADC_CHANNELS(ADC_CH_ENUM)
+    ADC_CHANNEL_COUNT
+};
+#undef ADC_CH_ENUM
+
+#if ADC_CHANNEL_COUNT > 8
+#error "SAADC has only 8 channels"
+#endif
+
+// Oversample 256x с BURST: один отсчёт канала длится 256 * (TACQ + 2 мкс)
+#define ADC_OVERSAMPLE_RATIO 256
+#define ADC_CH_TIME_US(name, pselp, gain, tacq) + ADC_OVERSAMPLE_RATIO * ((tacq) + 2)
+#define ADC_SCAN_TIME_US (0 ADC_CHANNELS(ADC_CH_TIME_US))
+
+#define ADC_FRAME_LEN 4 // сканов в одном DMA буфере
+#define ADC_SCAN_PERIOD_US 50000        // период фонового скана, мотор работает
+#define ADC_SCAN_IDLE_PERIOD_US 1000000 // мотор стоит: только батарея раз в секунду
+#define ADC_SCAN_RTC_MIN_US 100000      // от этого периода SAMPLE по k_timer (RTC), без TIMER2
+
+/**
+ * @brief Кадр отсчётов в виде struct-of-arrays
+ *
+ * ch[ADC_CH_x] - непрерывный массив отсчётов одного канала,
+ * фильтры проходят его без шага через соседние каналы.
+ */
+typedef struct
+{
+    uint16_t count; // заполненных сканов
+    int16_t ch[ADC_CHANNEL_COUNT][ADC_FRAME_LEN];
+} adc_frame_t;
+
+typedef void (*adc_stream_cb_t)(const adc_frame_t *frame);
+
+/*
+ * Выборка синхронно с ШИМ: PWM0 PWMPERIODEND через PPI запускает TIMER3,
+ * его COMPARE через PPI дают SAMPLE в середине включённого и (опционально)
+ * выключенного состояния. Сканируются только каналы CURRENT и MOTOR_V
+ * без oversample.
+ */
+#define ADC_SYNC_FRAME_LEN 8 // периодов ШИМ в одном DMA буфере
+
+typedef struct
+{
+    uint16_t count;      // заполненных периодов
+    bool current_valid;  // выборка попала в середину включённого состояния
+    bool bemf_valid;     // выборка попала в середину выключенного состояния
+    int16_t current[ADC_SYNC_FRAME_LEN]; // ток, середина включённого состояния
+    int16_t bemf[ADC_SYNC_FRAME_LEN];    // напряжение мотора (ЭДС), середина паузы
+} adc_sync_frame_t;
+
+typedef void (*adc_sync_cb_t)(const adc_sync_frame_t *frame);
+
+int adc_init(void);
+int16_t adc_read_registers(void);
+int adc_read_scan(int16_t out[ADC_CHANNEL_COUNT]);
+
+int adc_stream_start(uint32_t period_us, adc_stream_cb_t cb);
+void adc_stream_stop(void);
+int adc_stream_set_period(uint32_t period_us);
+void adc_stream_notify(struct k_event *event, uint32_t events);
+size_t adc_stream_read(int16_t *dst, size_t max);
+int adc_stream_wait(k_timeout_t timeout);
+const adc_frame_t *adc_stream_frame(void);
+uint32_t adc_stream_overruns(void);
+
+int adc_sync_start(bool bemf, adc_sync_cb_t cb);
+void adc_sync_stop(void);
+void adc_sync_set_pwm(uint32_t period_ns, uint32_t pulse_ns);
+const adc_sync_frame_t *adc_sync_frame(void);
+
+#endif /* ADC_H_ */
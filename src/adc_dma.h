@@ -0,0 +1,90 @@
+#ifndef ADC_DMA_H_
+#define ADC_DMA_H_
+
+/*
+ * Смена двойного буфера EasyDMA SAADC (потоковый режим adc.c).
+ *
+ * START защёлкивает RESULT.PTR, после STARTED в PTR можно класть следующий
+ * буфер. END через PPI сразу даёт новый START: если STARTED прошлого буфера
+ * не успели обработать, DMA защёлкивает старый PTR и пишет тот же буфер
+ * заново - это пропущенная смена, буфер теряется и учитывается в missed.
+ *
+ * Без зависимостей от Zephyr/nrfx, собирается и на хосте: ADC_DMA_REGS -
+ * тип блока регистров, на железе NRF_SAADC_Type, в тесте поддельный
+ * с теми же полями EVENTS_STARTED, EVENTS_END, RESULT.PTR/AMOUNT.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef ADC_DMA_REGS
+#error "define ADC_DMA_REGS (SAADC register block type) before including adc_dma.h"
+#endif
+
+typedef struct
+{
+    int16_t *buf[2];
+    uint8_t filling; // буфер, в который сейчас пишет DMA
+    bool armed;      // следующий буфер уже в RESULT.PTR
+    uint32_t done;   // отданных буферов
+    uint32_t missed; // пропущенных смен буфера
+} adc_dma_t;
+
+/**
+ * @brief Начальное состояние перед TASKS_START, буфер 0 - в RESULT.PTR
+ */
+static inline void adc_dma_reset(adc_dma_t *d, int16_t *buf0, int16_t *buf1)
+{
+    d->buf[0] = buf0;
+    d->buf[1] = buf1;
+    d->filling = 0;
+    d->armed = false;
+    d->done = 0;
+    d->missed = 0;
+}
+
+/**
+ * @brief Обработать события END и STARTED
+ *
+ * END обрабатывается раньше STARTED: если оба события уже выставлены,
+ * DMA пишет в следующий буфер и текущий можно отдавать.
+ *
+ * @param amount Отсчётов в заполненном буфере
+ * @return заполненный буфер или NULL (END не было или смена пропущена)
+ */
+static inline const int16_t *adc_dma_irq(adc_dma_t *d, ADC_DMA_REGS *saadc, uint32_t *amount)
+{
+    const int16_t *ready = NULL;
+
+    if (saadc->EVENTS_END)
+    {
+        saadc->EVENTS_END = 0;
+
+        if (d->armed)
+        {
+            ready = d->buf[d->filling];
+            *amount = saadc->RESULT.AMOUNT;
+            d->filling ^= 1;
+            d->done++;
+        }
+        else
+        {
+            // DMA уже снова пишет в этот же буфер
+            d->missed++;
+        }
+        d->armed = false;
+    }
+
+    if (saadc->EVENTS_STARTED)
+    {
+        saadc->EVENTS_STARTED = 0;
+        // Текущий буфер уже защёлкнут, готовим следующий
+        saadc->RESULT.PTR = (uintptr_t)d->buf[d->filling ^ 1];
+        d->armed = true;
+    }
+
+    return ready;
+}
+
+#endif /* ADC_DMA_H_ */
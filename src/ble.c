@@ -1,7 +1,64 @@
 #include "define.h"
 
+#include <stdlib.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "pwm_freq.h"
+#include "speed_ctrl.h"
+#include "telemetry.h"
+#include "settings_registry.h"
+#include "adc.h"
+#include "dlog.h"
+#include "ble_conn_param.h"
+#include "motor_cmd.h"
+#include "pwm_ramp.h"
+#include "duty_stream.h"
+
+// ==================== Уведомления о состоянии ====================
+/*
+ * Характеристика 0xABD6: упакованное состояние мотора и батареи.
+ * Уведомление уходит только при изменении (батарея - с гистерезисом и при
+ * пересечении порога разряда) и не чаще одного раза за интервал
+ * соединения: изменения внутри интервала сливаются в одно уведомление.
+ */
+#define BLE_STATUS_VBAT_HYST_MV 50
+#define BLE_STATUS_VBAT_LOW_MV 3300
+
+#define BLE_STATUS_MOTOR_ON BIT(0)
+#define BLE_STATUS_PWM_ACTIVE BIT(1)
+#define BLE_STATUS_VBAT_LOW BIT(2)
+#define BLE_STATUS_SPEED_MODE BIT(3)
+
+typedef struct __packed
+{
+    uint16_t duty16;
+    uint8_t flags;   // BLE_STATUS_*
+    uint8_t faults;  // TELEM_FAULT_* с прошлого уведомления
+    uint16_t vbat_mv;
+} ble_status_t;
+
+static struct
+{
+    bool notify;          // клиент подписан (CCC)
+    bool force;           // отправить текущее состояние без сравнения
+    ble_status_t last;    // последнее отправленное
+    uint32_t last_ms;     // время последнего уведомления
+    uint32_t interval_ms; // интервал соединения
+    atomic_t faults;      // накопленные с прошлого уведомления (main и очередь)
+    uint32_t adc_overruns;
+    uint32_t log_dropped;
+    uint32_t sent;
+    uint32_t suppressed;  // изменения, не давшие своего уведомления
+    uint32_t errors;
+} ble_status = {.interval_ms = 50};
+
+static void ble_status_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(ble_status_work, ble_status_work_handler);
+
 void connected(struct bt_conn *conn, uint8_t err)
 {
+    struct bt_conn_info info;
+
     if (err)
     {
         printk("BLE Connection failed: %u\n", err);
@@ -9,17 +66,32 @@ void connected(struct bt_conn *conn, uint8_t err)
     else
     {
         printk("BLE Connected\n");
+        if (bt_conn_get_info(conn, &info) == 0)
+        {
+            ble_status.interval_ms = BT_CONN_INTERVAL_TO_MS(info.le.interval);
+        }
+        ble_conn_param_connected(conn);
     }
 }
 
 void disconnected(struct bt_conn *conn, uint8_t reason)
 {
-    printk("BLE Disconnected (reason: %u)\n", reason);
+    printk("BLE Disconnected (reason: %u), notify sent %u, suppressed %u\n", reason,
+           ble_status.sent, ble_status.suppressed);
+    ble_conn_param_disconnected();
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+                             uint16_t timeout)
+{
+    ble_status.interval_ms = BT_CONN_INTERVAL_TO_MS(interval);
+    ble_conn_param_updated(interval, latency);
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
 };
 
 const struct bt_data ad[] = {
@@ -46,6 +118,23 @@ void ble_start_adv()
 }
 
 // ==================== BLE GATT ====================
+/*
+ * Команды мотору здесь только проверяются и ставятся в очередь
+ * (motor_cmd.h): ШИМ, частота, шаблон, регулятор скорости, лог и
+ * сохранение настроек - в потоке-владельце, поток BT RX не ждёт.
+ */
+static ssize_t ble_motor_cmd(motor_cmd_type_t type, int32_t value, uint8_t flags, uint16_t len)
+{
+    if (motor_cmd_post(type, value, flags | MOTOR_CMD_F_BLE))
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+
+    ble_conn_param_activity();
+    k_event_post(&main_events, MAIN_EV_BLE);
+    return len;
+}
+
 static ssize_t read_duty_cycle(struct bt_conn *conn, const struct bt_gatt_attr *attr,
                                void *buf, uint16_t len, uint16_t offset)
 {
@@ -68,16 +157,7 @@ static ssize_t write_duty_cycle(struct bt_conn *conn, const struct bt_gatt_attr
         return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
     }
 
-    global_duty_cycle = new_duty;
-    printk("BLE: Set duty to %d%%\n", global_duty_cycle);
-
-    if (global_motor_on)
-    {
-        motor_set_pwm(global_duty_cycle);
-    }
-
-    //nvs_save_settings();
-    return len;
+    return ble_motor_cmd(MOTOR_CMD_DUTY16, MOTOR_PCT_TO_DUTY16(new_duty), MOTOR_CMD_F_SAVE, len);
 }
 
 static ssize_t read_motor_state(struct bt_conn *conn, const struct bt_gatt_attr *attr,
@@ -96,13 +176,488 @@ static ssize_t write_motor_state(struct bt_conn *conn, const struct bt_gatt_attr
         return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
     }
 
-    uint8_t new_state = *((uint8_t *)buf);
-    global_motor_on = (new_state != 0);
+    return ble_motor_cmd(MOTOR_CMD_RUN, *((uint8_t *)buf), MOTOR_CMD_F_SAVE, len);
+}
+
+static ssize_t read_duty16(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t value[2];
+
+    sys_put_le16(global_duty16, value);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+// 2 байта little-endian: скважность 0-65535
+static ssize_t write_duty16(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            const void *buf, uint16_t len, uint16_t offset,
+                            uint8_t flags)
+{
+    if (len != 2)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    return ble_motor_cmd(MOTOR_CMD_DUTY16, sys_get_le16(buf), MOTOR_CMD_F_SAVE, len);
+}
+
+#define PWM_FREQ_HZ(hz, prescaler, top, bits) (hz),
+static const uint32_t pwm_freq_offered[] = {PWM_FREQ_TABLE(PWM_FREQ_HZ)};
+#undef PWM_FREQ_HZ
+
+// Частота ШИМ, Гц (uint32 LE) + разрешение скважности, бит (5 байт),
+// затем предлагаемые частоты PWM_FREQ_TABLE, uint32 LE каждая
+static ssize_t read_pwm_freq(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    pwm_freq_cfg_t cfg;
+    uint8_t value[5 + sizeof(pwm_freq_offered)];
+
+    pwm_freq_calc(global_pwm_freq, &cfg);
+    sys_put_le32(cfg.actual_hz, value);
+    value[4] = cfg.bits;
+    for (size_t i = 0; i < ARRAY_SIZE(pwm_freq_offered); i++)
+    {
+        sys_put_le32(pwm_freq_offered[i], value + 5 + 4 * i);
+    }
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+// 4 байта little-endian: частота ШИМ, Гц
+static ssize_t write_pwm_freq(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset,
+                              uint8_t flags)
+{
+    if (len != 4)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    uint32_t hz = sys_get_le32(buf);
+    pwm_freq_cfg_t cfg;
+
+    if (!pwm_freq_calc(hz, &cfg))
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    return ble_motor_cmd(MOTOR_CMD_FREQ, hz, MOTOR_CMD_F_SAVE, len);
+}
+
+static ssize_t read_pattern(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            void *buf, uint16_t len, uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset,
+                             &global_pattern, sizeof(global_pattern));
+}
+
+// 1 байт: id шаблона (0 - стоп); больше: id + шаблон для записи в flash
+static ssize_t write_pattern(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             const void *buf, uint16_t len, uint16_t offset,
+                             uint8_t flags)
+{
+    const uint8_t *data = buf;
+    int err;
+
+    if (len == 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    if (len == 1)
+    {
+        if (pattern_check(data[0]))
+        {
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+        }
+        return ble_motor_cmd(MOTOR_CMD_PATTERN, data[0], 0, len);
+    }
+
+    // Только проверка и копия в RAM, flash пишется из системной очереди
+    err = pattern_store(data[0], data + 1, len - 1);
+    printk("BLE: Store pattern %u (%d)\n", data[0], err);
+    if (err == -EBUSY)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+    if (err)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    ble_conn_param_activity();
+    k_event_post(&main_events, MAIN_EV_BLE);
+    return len;
+}
+
+// 8 байт LE: уставка и измеренная скорость, об/мин; макс. джиттер и время шага, мкс
+static ssize_t read_speed(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          void *buf, uint16_t len, uint16_t offset)
+{
+    speed_ctrl_stats_t stats;
+    uint8_t value[8];
+
+    speed_ctrl_get_stats(&stats);
+    sys_put_le16(global_speed_rpm, value);
+    sys_put_le16(speed_ctrl_measured_rpm(), value + 2);
+    sys_put_le16(MIN(stats.jitter_max_us, UINT16_MAX), value + 4);
+    sys_put_le16(MIN(k_cyc_to_us_floor32(stats.exec_max_cyc), UINT16_MAX), value + 6);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+// 2 байта little-endian: скорость, об/мин (0 - стоп)
+static ssize_t write_speed(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len, uint16_t offset,
+                           uint8_t flags)
+{
+    if (len != 2)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    uint16_t rpm = sys_get_le16(buf);
+
+    if (rpm > SPEED_RPM_MAX)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    return ble_motor_cmd(MOTOR_CMD_RPM, rpm, 0, len);
+}
+
+// Все настройки из реестра: TLV [ключ][длина][значение LE]... (settings_registry.h)
+static ssize_t read_settings(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t value[SETTINGS_DATA_MAX];
+    size_t n = settings_registry_pack(value, sizeof(value));
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, n);
+}
+
+// Любое подмножество настроек; при ошибке в любой записи не меняется ничего
+static ssize_t write_settings(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset,
+                              uint8_t flags)
+{
+    if (offset != 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    // Значения применит и сохранит владелец мотора (обработчики реестра)
+    int n = settings_registry_unpack(buf, len, true);
+    DLOG_INF("BLE: Settings %d\n", n);
+    if (n == -EINVAL)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    if (n == -ENOBUFS)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+    if (n < 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    ble_conn_param_activity();
+    k_event_post(&main_events, MAIN_EV_BLE);
+    return len;
+}
+
+// ==================== Пакет команд ====================
+/*
+ * Характеристика 0xABD7: несколько команд одной записью.
+ * TLV [тег][длина][значение LE]..., каждый тег не больше одного раза.
+ *
+ * Разбор идёт прямо по буферу ATT без копирования, в два прохода:
+ * проверка всего пакета (включая шаблон), затем одна команда владельцу
+ * мотора (motor_cmd_post_set()): частота, разгон, шаблон, скважность
+ * и пуск, сохранение настроек. Полная очередь - не применяется ничего.
+ * Результат - одно уведомление (и чтение) ble_batch_resp_t.
+ */
+#define BATCH_TAG_DUTY16 0x01   // 2 байта
+#define BATCH_TAG_RUN 0x02      // 1 байт, 0 - стоп
+#define BATCH_TAG_RAMP 0x03     // 1 байт, pwm_ramp_t
+#define BATCH_TAG_PATTERN 0x04  // 1 байт, id шаблона (0 - стоп); не вместе с DUTY16/RUN
+#define BATCH_TAG_PWM_FREQ 0x05 // 4 байта, Гц
+#define BATCH_TAG_SAVE 0x06     // 0 байт, записать настройки во flash сразу
+#define BATCH_TAG_COUNT 7
+
+typedef struct __packed
+{
+    int8_t status; // 0 или -errno
+    uint8_t tag;   // тег, на котором ошибка, 0 - ошибка пакета целиком
+    uint8_t count; // команд в пакете
+} ble_batch_resp_t;
+
+static const uint8_t batch_tag_len[BATCH_TAG_COUNT] = {
+    [BATCH_TAG_DUTY16] = 2,
+    [BATCH_TAG_RUN] = 1,
+    [BATCH_TAG_RAMP] = 1,
+    [BATCH_TAG_PATTERN] = 1,
+    [BATCH_TAG_PWM_FREQ] = 4,
+    [BATCH_TAG_SAVE] = 0,
+};
+
+static ble_batch_resp_t batch_resp;
+
+// Значения пакета: указатели в буфер ATT, NULL - тега нет
+typedef struct
+{
+    const uint8_t *val[BATCH_TAG_COUNT];
+    uint8_t count;
+} ble_batch_t;
+
+static int batch_parse(const uint8_t *p, uint16_t len, ble_batch_t *b, uint8_t *bad_tag)
+{
+    const uint8_t *end = p + len;
+
+    memset(b, 0, sizeof(*b));
+    while (p < end)
+    {
+        if (end - p < 2 || end - p - 2 < p[1])
+        {
+            *bad_tag = 0; // ошибка разметки пакета, а не тега
+            return -EINVAL;
+        }
+
+        uint8_t tag = p[0];
+        *bad_tag = tag;
+        if (tag == 0 || tag >= BATCH_TAG_COUNT || p[1] != batch_tag_len[tag] || b->val[tag])
+        {
+            return -EINVAL;
+        }
+
+        b->val[tag] = p + 2;
+        b->count++;
+        p += 2 + p[1];
+    }
+
+    if (b->val[BATCH_TAG_RAMP] && *b->val[BATCH_TAG_RAMP] >= PWM_RAMP_COUNT)
+    {
+        *bad_tag = BATCH_TAG_RAMP;
+        return -ERANGE;
+    }
+    if (b->val[BATCH_TAG_PWM_FREQ])
+    {
+        pwm_freq_cfg_t cfg;
+
+        *bad_tag = BATCH_TAG_PWM_FREQ;
+        if (!pwm_freq_calc(sys_get_le32(b->val[BATCH_TAG_PWM_FREQ]), &cfg))
+        {
+            return -ERANGE;
+        }
+    }
+    if (b->val[BATCH_TAG_PATTERN])
+    {
+        *bad_tag = BATCH_TAG_PATTERN;
+        if (b->val[BATCH_TAG_DUTY16] || b->val[BATCH_TAG_RUN])
+        {
+            // Шаблон сам управляет скважностью
+            return -EINVAL;
+        }
+
+        int err = pattern_check(*b->val[BATCH_TAG_PATTERN]);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    *bad_tag = 0;
+    return 0;
+}
+
+// Всё проверено в batch_parse(): одна команда владельцу, применяется целиком
+static int batch_apply(const ble_batch_t *b)
+{
+    const uint8_t *const *v = b->val;
+    motor_set_t set = {0};
+    uint8_t flags = MOTOR_CMD_F_SAVE | MOTOR_CMD_F_BLE | (v[BATCH_TAG_SAVE] ? MOTOR_CMD_F_FLUSH : 0);
+
+    if (v[BATCH_TAG_PWM_FREQ])
+    {
+        set.mask |= MOTOR_SET_FREQ;
+        set.freq = sys_get_le32(v[BATCH_TAG_PWM_FREQ]);
+    }
+    if (v[BATCH_TAG_RAMP])
+    {
+        set.mask |= MOTOR_SET_RAMP;
+        set.ramp = *v[BATCH_TAG_RAMP];
+    }
+    if (v[BATCH_TAG_PATTERN])
+    {
+        set.mask |= MOTOR_SET_PATTERN;
+        set.pattern = *v[BATCH_TAG_PATTERN];
+    }
+    if (v[BATCH_TAG_DUTY16])
+    {
+        set.mask |= MOTOR_SET_DUTY16;
+        set.duty16 = sys_get_le16(v[BATCH_TAG_DUTY16]);
+    }
+    if (v[BATCH_TAG_RUN])
+    {
+        set.mask |= MOTOR_SET_RUN;
+        set.run = *v[BATCH_TAG_RUN];
+    }
+
+    return motor_cmd_post_set(&set, flags);
+}
+
+static ssize_t read_batch(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          void *buf, uint16_t len, uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &batch_resp, sizeof(batch_resp));
+}
+
+// Запись принимается всегда, результат - в уведомлении
+static ssize_t write_batch(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len, uint16_t offset,
+                           uint8_t flags)
+{
+    ble_batch_t b;
+    uint8_t tag = 0;
+
+    if (offset != 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    int err = batch_parse(buf, len, &b, &tag);
+    if (!err)
+    {
+        err = batch_apply(&b);
+    }
+
+    batch_resp.status = err;
+    batch_resp.tag = tag;
+    batch_resp.count = b.count;
+    printk("BLE: Batch %u cmds: %d (tag %u)\n", b.count, err, tag);
+
+    if (!err)
+    {
+        ble_conn_param_activity();
+        k_event_post(&main_events, MAIN_EV_BLE);
+    }
+
+    // attr - значение характеристики, за ним CCC
+    if (bt_gatt_is_subscribed(conn, attr, BT_GATT_CCC_NOTIFY))
+    {
+        bt_gatt_notify(conn, attr, &batch_resp, sizeof(batch_resp));
+    }
+    return len;
+}
+
+// ==================== Поток уставок ====================
+// 0xABD8, запись без ответа: пакеты duty_stream_hdr_t + duty16... (duty_stream.h)
+static ssize_t write_duty_stream(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 const void *buf, uint16_t len, uint16_t offset,
+                                 uint8_t flags)
+{
+    if (offset != 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    int err = duty_stream_put(buf, len);
+    if (err == -ENOBUFS)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+    if (err)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    ble_conn_param_activity();
+    return len;
+}
+
+// Счётчики джиттер-буфера, duty_stream_stats_t
+static ssize_t read_duty_stream(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                void *buf, uint16_t len, uint16_t offset)
+{
+    duty_stream_stats_t stats;
+
+    duty_stream_get_stats(&stats);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &stats, sizeof(stats));
+}
+
+static void ble_status_get(ble_status_t *s)
+{
+    s->duty16 = global_duty16;
+    s->flags = (global_motor_on ? BLE_STATUS_MOTOR_ON : 0) |
+               (global_pwm_active ? BLE_STATUS_PWM_ACTIVE : 0) |
+               (global_vbat_mv < BLE_STATUS_VBAT_LOW_MV ? BLE_STATUS_VBAT_LOW : 0) |
+               (global_speed_rpm ? BLE_STATUS_SPEED_MODE : 0);
+    s->faults = (uint8_t)atomic_get(&ble_status.faults);
+    s->vbat_mv = global_vbat_mv;
+}
+
+static ssize_t read_status(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           void *buf, uint16_t len, uint16_t offset)
+{
+    ble_status_t s;
+
+    ble_status_get(&s);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &s, sizeof(s));
+}
+
+static void status_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ble_status.notify = (value == BT_GATT_CCC_NOTIFY);
+    ble_status.force = ble_status.notify;
+    printk("BLE: Status notify %s\n", ble_status.notify ? "on" : "off");
+}
+
+/*
+ * Журнал телеметрии (telemetry.h). Атрибут GATT не длиннее
+ * BT_ATT_MAX_ATTRIBUTE_LEN (512 байт), а журнал - до десятков КБ: чтение
+ * отдаёт окно до 512 байт с позиции курсора, запись 4 байт LE32 ставит
+ * курсор. Весь журнал одним проходом - потоком 0xABE0 (ble_stream.h).
+ */
+static uint32_t telem_cursor;
+
+static ssize_t read_telemetry(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              void *buf, uint16_t len, uint16_t offset)
+{
+    int size = telemetry_size();
+
+    if (size < 0)
+    {
+        // Идёт стирание/запись журнала, поток BT RX не ждёт
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+
+    uint32_t window = (uint32_t)size > telem_cursor ? (uint32_t)size - telem_cursor : 0;
+
+    window = MIN(window, BT_ATT_MAX_ATTRIBUTE_LEN);
+    if (offset > window)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    int n = telemetry_read(telem_cursor + offset, buf, MIN(len, window - offset));
 
-    printk("BLE: Motor %s\n", global_motor_on ? "ON" : "OFF");
-    motor_set_pwm(global_motor_on ? global_duty_cycle : 0);
-    //nvs_save_settings();
+    return n < 0 ? BT_GATT_ERR(BT_ATT_ERR_UNLIKELY) : n;
+}
 
+static ssize_t write_telemetry(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                               const void *buf, uint16_t len, uint16_t offset,
+                               uint8_t flags)
+{
+    if (offset)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len != 4)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    telem_cursor = sys_get_le32(buf);
     return len;
 }
 
@@ -115,4 +670,143 @@ BT_GATT_SERVICE_DEFINE(motor_svc,
                        BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABCF),
                                               BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
                                               BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
-                                              read_motor_state, write_motor_state, NULL), );
+                                              read_motor_state, write_motor_state, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD0),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_pattern, write_pattern, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD1),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_duty16, write_duty16, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD2),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_pwm_freq, write_pwm_freq, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD3),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_speed, write_speed, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD4),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_telemetry, write_telemetry, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD5),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_settings, write_settings, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD6),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ,
+                                              read_status, NULL, NULL),
+                       BT_GATT_CCC(status_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD7),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_batch, write_batch, NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABD8),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_duty_stream, write_duty_stream, NULL), );
+
+static void ble_status_send(void)
+{
+    static const struct bt_gatt_attr *attr;
+    ble_status_t s;
+
+    if (!attr)
+    {
+        attr = bt_gatt_find_by_uuid(motor_svc.attrs, motor_svc.attr_count, BT_UUID_DECLARE_16(0xABD6));
+    }
+
+    ble_status_get(&s);
+    int err = bt_gatt_notify(NULL, attr, &s, sizeof(s));
+    if (err)
+    {
+        // Нет места в буферах - отправим при следующем изменении
+        ble_status.errors++;
+        return;
+    }
+
+    /*
+     * Сбрасываются только отправленные биты: main мог добавить новый между
+     * ble_status_get() и этим местом. last.faults тоже в ноль - сбои
+     * сообщаются однократно, их сброс не повод для второго уведомления.
+     */
+    atomic_and(&ble_status.faults, ~(atomic_val_t)s.faults);
+    ble_status.last = s;
+    ble_status.last.faults = 0;
+    ble_status.last_ms = k_uptime_get_32();
+    ble_status.force = false;
+    ble_status.sent++;
+}
+
+static void ble_status_work_handler(struct k_work *work)
+{
+    if (ble_status.notify)
+    {
+        ble_status_send();
+    }
+}
+
+/**
+ * @brief Проверить состояние и при значимом изменении уведомить клиента
+ *
+ * Вызывается из главного цикла на каждом пробуждении (кадр ADC, запись BLE).
+ */
+void ble_status_poll(void)
+{
+    ble_status_t s;
+
+    // Сбои копятся всегда, чтобы первое уведомление после подписки их показало
+    if (adc_stream_overruns() != ble_status.adc_overruns)
+    {
+        ble_status.adc_overruns = adc_stream_overruns();
+        atomic_or(&ble_status.faults, TELEM_FAULT_ADC_OVERRUN);
+    }
+    if (dlog_dropped() != ble_status.log_dropped)
+    {
+        ble_status.log_dropped = dlog_dropped();
+        atomic_or(&ble_status.faults, TELEM_FAULT_LOG_DROPPED);
+    }
+
+    if (!ble_status.notify)
+    {
+        return;
+    }
+
+    ble_status_get(&s);
+
+    bool changed = ble_status.force || s.duty16 != ble_status.last.duty16 ||
+                   s.flags != ble_status.last.flags || s.faults != ble_status.last.faults;
+    bool vbat_moved = s.vbat_mv != ble_status.last.vbat_mv;
+
+    if (abs((int)s.vbat_mv - ble_status.last.vbat_mv) >= BLE_STATUS_VBAT_HYST_MV)
+    {
+        changed = true;
+    }
+
+    if (!changed)
+    {
+        if (vbat_moved)
+        {
+            ble_status.suppressed++;
+        }
+        return;
+    }
+
+    /*
+     * Отправка всегда из системной очереди, не чаще раза за интервал
+     * соединения: изменения, пришедшие до отправки, сливаются в одно.
+     */
+    if (k_work_delayable_is_pending(&ble_status_work))
+    {
+        ble_status.suppressed++;
+        return;
+    }
+
+    uint32_t since = k_uptime_get_32() - ble_status.last_ms;
+    k_work_schedule(&ble_status_work,
+                    since < ble_status.interval_ms ? K_MSEC(ble_status.interval_ms - since) : K_NO_WAIT);
+}
@@ -0,0 +1,204 @@
+#include "define.h"
+#include "ble_conn_param.h"
+
+/*
+ * Ограничение на таймаут: timeout * 10 мс > (1 + latency) * interval_max * 1.25 мс * 2.
+ * IDLE: 6000 > 5 * 500 * 2 = 5000.
+ */
+static const struct bt_le_conn_param conn_profiles[BLE_CONN_PROFILE_COUNT] = {
+    [BLE_CONN_PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(320, 400, 4, 600),  // 400-500 мс
+    [BLE_CONN_PROFILE_ACTIVE] = BT_LE_CONN_PARAM_INIT(12, 24, 0, 400),  // 15-30 мс
+    [BLE_CONN_PROFILE_BULK] = BT_LE_CONN_PARAM_INIT(6, 9, 0, 400),      // 7.5-11.25 мс
+};
+
+static struct bt_conn *conn_param_conn;
+static bool conn_param_active;
+static bool conn_param_bulk_on;
+static uint8_t conn_param_wanted;  // последний запрошенный профиль
+static uint8_t conn_param_current; // действующий, по интервалу от центрального устройства
+static uint32_t conn_param_since_ms;
+static ble_conn_param_stats_t conn_param_stats;
+static struct k_spinlock conn_param_lock;
+
+static void conn_param_apply_handler(struct k_work *work);
+static void conn_param_idle_handler(struct k_work *work);
+static K_WORK_DEFINE(conn_param_apply_work, conn_param_apply_handler);
+static K_WORK_DELAYABLE_DEFINE(conn_param_idle_work, conn_param_idle_handler);
+
+static uint8_t conn_param_pick(void)
+{
+    if (conn_param_bulk_on)
+    {
+        return BLE_CONN_PROFILE_BULK;
+    }
+    return conn_param_active ? BLE_CONN_PROFILE_ACTIVE : BLE_CONN_PROFILE_IDLE;
+}
+
+// Профиль по интервалу: центральное устройство выбирает внутри [min, max]
+static uint8_t conn_param_classify(uint16_t interval)
+{
+    for (uint8_t p = 0; p < BLE_CONN_PROFILE_COUNT; p++)
+    {
+        if (interval >= conn_profiles[p].interval_min && interval <= conn_profiles[p].interval_max)
+        {
+            return p;
+        }
+    }
+    // Вне всех профилей (параметры при подключении) - ближайший по длине
+    return interval > conn_profiles[BLE_CONN_PROFILE_ACTIVE].interval_max ? BLE_CONN_PROFILE_IDLE
+                                                                          : BLE_CONN_PROFILE_ACTIVE;
+}
+
+// Вызывать под conn_param_lock
+static void conn_param_account(void)
+{
+    uint32_t now = k_uptime_get_32();
+
+    conn_param_stats.time_ms[conn_param_current] += now - conn_param_since_ms;
+    conn_param_since_ms = now;
+}
+
+static void conn_param_apply_handler(struct k_work *work)
+{
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    struct bt_conn *conn = conn_param_conn ? bt_conn_ref(conn_param_conn) : NULL;
+    uint8_t profile = conn_param_pick();
+    bool send = conn && profile != conn_param_wanted;
+
+    if (send)
+    {
+        conn_param_wanted = profile;
+        conn_param_stats.requests++;
+    }
+    k_spin_unlock(&conn_param_lock, key);
+
+    if (send)
+    {
+        int err = bt_conn_le_param_update(conn, &conn_profiles[profile]);
+        if (err)
+        {
+            conn_param_stats.rejected++;
+            printk("BLE: conn param %u request failed: %d\n", profile, err);
+        }
+    }
+    if (conn)
+    {
+        bt_conn_unref(conn);
+    }
+}
+
+static void conn_param_idle_handler(struct k_work *work)
+{
+    conn_param_active = false;
+    k_work_submit(&conn_param_apply_work);
+}
+
+void ble_conn_param_connected(struct bt_conn *conn)
+{
+    struct bt_conn_info info;
+    uint16_t interval = conn_profiles[BLE_CONN_PROFILE_IDLE].interval_max;
+    uint16_t latency = 0;
+
+    if (bt_conn_get_info(conn, &info) == 0)
+    {
+        interval = info.le.interval;
+        latency = info.le.latency;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    conn_param_conn = bt_conn_ref(conn);
+    conn_param_current = conn_param_classify(interval);
+    conn_param_wanted = BLE_CONN_PROFILE_COUNT; // ещё ничего не запрашивали
+    conn_param_since_ms = k_uptime_get_32();
+    conn_param_stats.air_max_ms = BT_CONN_INTERVAL_TO_MS(interval) * (latency + 1);
+    k_spin_unlock(&conn_param_lock, key);
+
+    // Сразу после подключения клиент обычно обнаруживает сервисы и управляет
+    ble_conn_param_activity();
+}
+
+void ble_conn_param_disconnected(void)
+{
+    k_work_cancel_delayable(&conn_param_idle_work);
+
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    struct bt_conn *conn = conn_param_conn;
+
+    if (conn)
+    {
+        conn_param_account();
+    }
+    conn_param_conn = NULL;
+    conn_param_active = false;
+    conn_param_bulk_on = false;
+    k_spin_unlock(&conn_param_lock, key);
+
+    if (conn)
+    {
+        bt_conn_unref(conn);
+        printk("BLE: conn time idle %u ms, active %u ms, bulk %u ms; PWM latency max %u us\n",
+               conn_param_stats.time_ms[BLE_CONN_PROFILE_IDLE],
+               conn_param_stats.time_ms[BLE_CONN_PROFILE_ACTIVE],
+               conn_param_stats.time_ms[BLE_CONN_PROFILE_BULK], conn_param_stats.pwm_lat_max_us);
+    }
+}
+
+void ble_conn_param_updated(uint16_t interval, uint16_t latency)
+{
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    uint8_t profile = conn_param_classify(interval);
+
+    if (conn_param_conn)
+    {
+        conn_param_account();
+    }
+    if (conn_param_wanted < BLE_CONN_PROFILE_COUNT && profile != conn_param_wanted)
+    {
+        conn_param_stats.rejected++;
+    }
+    conn_param_current = profile;
+    conn_param_stats.air_max_ms = BT_CONN_INTERVAL_TO_MS(interval) * (latency + 1);
+    k_spin_unlock(&conn_param_lock, key);
+}
+
+void ble_conn_param_activity(void)
+{
+    if (!conn_param_conn)
+    {
+        return;
+    }
+    k_work_reschedule(&conn_param_idle_work, K_SECONDS(BLE_CONN_IDLE_S));
+    if (!conn_param_active)
+    {
+        conn_param_active = true;
+        k_work_submit(&conn_param_apply_work);
+    }
+}
+
+void ble_conn_param_bulk(bool on)
+{
+    conn_param_bulk_on = on;
+    k_work_submit(&conn_param_apply_work);
+}
+
+void ble_conn_param_pwm_latency(uint32_t start_cyc)
+{
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cyc);
+
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    conn_param_stats.pwm_lat_max_us = MAX(conn_param_stats.pwm_lat_max_us, us);
+    conn_param_stats.pwm_lat_sum_us += us;
+    conn_param_stats.pwm_lat_count++;
+    k_spin_unlock(&conn_param_lock, key);
+}
+
+void ble_conn_param_get_stats(ble_conn_param_stats_t *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&conn_param_lock);
+    if (conn_param_conn)
+    {
+        conn_param_account();
+    }
+    *stats = conn_param_stats;
+    k_spin_unlock(&conn_param_lock, key);
+}
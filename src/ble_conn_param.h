@@ -0,0 +1,70 @@
+#ifndef BLE_CONN_PARAM_H_
+#define BLE_CONN_PARAM_H_
+
+#include <zephyr/bluetooth/conn.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Параметры соединения по активности.
+ *
+ *  IDLE   - долгий интервал и латентность, пока никто не управляет
+ *  ACTIVE - короткий интервал без латентности на время управления
+ *           мотором и BLE_CONN_IDLE_S после последней команды
+ *  BULK   - минимальный интервал на время потоковой передачи (ble_stream.c)
+ *
+ * Запросы уходят из системной очереди работ, профиль считается
+ * действующим, когда центральное устройство сообщит новый интервал.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLE_CONN_IDLE_S 10
+
+enum ble_conn_profile
+{
+    BLE_CONN_PROFILE_IDLE,
+    BLE_CONN_PROFILE_ACTIVE,
+    BLE_CONN_PROFILE_BULK,
+    BLE_CONN_PROFILE_COUNT
+};
+
+typedef struct
+{
+    uint32_t time_ms[BLE_CONN_PROFILE_COUNT]; // время в каждом профиле
+    uint32_t requests;
+    uint32_t rejected;        // запрос не ушёл или центральное устройство выбрало другой интервал
+    uint32_t air_max_ms;      // (латентность + 1) * интервал действующих параметров
+    uint32_t pwm_lat_max_us;  // от записи BLE до применения ШИМ
+    uint32_t pwm_lat_sum_us;
+    uint32_t pwm_lat_count;
+} ble_conn_param_stats_t;
+
+void ble_conn_param_connected(struct bt_conn *conn);
+void ble_conn_param_disconnected(void);
+void ble_conn_param_updated(uint16_t interval, uint16_t latency);
+
+/**
+ * @brief Команда управления мотором: ACTIVE и перезапуск таймера простоя
+ */
+void ble_conn_param_activity(void);
+
+/**
+ * @brief Потоковая передача началась/закончилась
+ */
+void ble_conn_param_bulk(bool on);
+
+/**
+ * @brief Учесть задержку от входа в обработчик записи до применения ШИМ
+ * @param start_cyc k_cycle_get_32() на входе в обработчик
+ */
+void ble_conn_param_pwm_latency(uint32_t start_cyc);
+
+void ble_conn_param_get_stats(ble_conn_param_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_CONN_PARAM_H_ */
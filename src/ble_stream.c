@@ -0,0 +1,354 @@
+#include "define.h"
+#include "ble_stream.h"
+#include "telemetry.h"
+#include "ble_conn_param.h"
+
+#include <zephyr/sys/byteorder.h>
+
+#define STREAM_CREDITS (CONFIG_BT_L2CAP_TX_BUF_COUNT - 2) // остальное - под уведомления 0xABD6 и ответы ATT
+#define STREAM_CHUNK_MAX (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define STREAM_CREDIT_TIMEOUT_MS 2000 // нет подтверждений отправки - поток прерывается
+#define STREAM_STACK_SIZE 1024
+#define STREAM_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO - 1)
+
+BUILD_ASSERT(STREAM_CREDITS >= 2, "raise CONFIG_BT_L2CAP_TX_BUF_COUNT");
+
+static struct bt_conn *stream_conn;
+static atomic_t stream_run;
+static uint8_t stream_source;
+static uint32_t stream_len; // только для BLE_STREAM_SRC_TEST
+static ble_stream_stats_t stream_stats;
+static uint8_t stream_chunk[STREAM_CHUNK_MAX];
+
+K_SEM_DEFINE(stream_start_sem, 0, 1);
+K_SEM_DEFINE(stream_credits, STREAM_CREDITS, STREAM_CREDITS);
+
+static void stream_connected(struct bt_conn *conn, uint8_t err)
+{
+    if (!err)
+    {
+        stream_conn = bt_conn_ref(conn);
+        stream_stats.mtu = BT_ATT_DEFAULT_LE_MTU;
+        stream_stats.tx_octets = BT_GAP_DATA_LEN_DEFAULT;
+        stream_stats.tx_phy = BT_GAP_LE_PHY_1M;
+    }
+}
+
+static void stream_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    if (stream_conn == conn)
+    {
+        // Поток увидит ошибку отправки и завершится сам
+        atomic_clear(&stream_run);
+        bt_conn_unref(stream_conn);
+        stream_conn = NULL;
+    }
+}
+
+static void stream_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    stream_stats.tx_phy = param->tx_phy;
+    printk("BLE stream: PHY tx %u rx %u\n", param->tx_phy, param->rx_phy);
+}
+
+static void stream_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    stream_stats.tx_octets = info->tx_max_len;
+    printk("BLE stream: DLE tx %u rx %u\n", info->tx_max_len, info->rx_max_len);
+}
+
+BT_CONN_CB_DEFINE(stream_conn_callbacks) = {
+    .connected = stream_connected,
+    .disconnected = stream_disconnected,
+    .le_phy_updated = stream_phy_updated,
+    .le_data_len_updated = stream_data_len_updated,
+};
+
+static void stream_mtu_exchanged(struct bt_conn *conn, uint8_t err,
+                                 struct bt_gatt_exchange_params *params)
+{
+    stream_stats.mtu = bt_gatt_get_mtu(conn);
+    printk("BLE stream: MTU %u (%u)\n", stream_stats.mtu, err);
+}
+
+static struct bt_gatt_exchange_params stream_mtu_params = {
+    .func = stream_mtu_exchanged,
+};
+
+/**
+ * @brief Запросить быстрый или экономичный режим соединения
+ *
+ * Все запросы асинхронные: данные идут сразу, скорость растёт по мере
+ * того, как центральное устройство принимает параметры.
+ */
+static void stream_set_fast(struct bt_conn *conn, bool fast)
+{
+    int err;
+
+    // Интервал - через менеджер параметров соединения (профиль BULK)
+    ble_conn_param_bulk(fast);
+
+    if (fast)
+    {
+        err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+        if (!err)
+        {
+            err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+        }
+        if (bt_gatt_get_mtu(conn) < CONFIG_BT_L2CAP_TX_MTU)
+        {
+            // Второй обмен в соединении стек отклонит - ошибка не важна
+            bt_gatt_exchange_mtu(conn, &stream_mtu_params);
+        }
+    }
+    else
+    {
+        err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_1M);
+        if (!err)
+        {
+            err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_DEFAULT);
+        }
+    }
+
+    if (err)
+    {
+        printk("BLE stream: %s mode request failed: %d\n", fast ? "fast" : "slow", err);
+    }
+}
+
+static void stream_sent(struct bt_conn *conn, void *user_data)
+{
+    k_sem_give(&stream_credits);
+}
+
+// ==================== BLE GATT ====================
+
+static ssize_t read_stream_ctrl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                void *buf, uint16_t len, uint16_t offset)
+{
+    ble_stream_stats_t stats;
+
+    ble_stream_get_stats(&stats);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &stats, sizeof(stats));
+}
+
+static ssize_t write_stream_ctrl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 const void *buf, uint16_t len, uint16_t offset,
+                                 uint8_t flags)
+{
+    const uint8_t *data = buf;
+
+    if (offset != 0 || len < 1)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    if (data[0] == BLE_STREAM_CMD_STOP)
+    {
+        atomic_clear(&stream_run);
+        return len;
+    }
+
+    if (data[0] != BLE_STREAM_CMD_START || len < 2)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    if (data[1] == BLE_STREAM_SRC_TEST && len != 6)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    if (data[1] != BLE_STREAM_SRC_TELEMETRY && data[1] != BLE_STREAM_SRC_TEST)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    if (!atomic_cas(&stream_run, 0, 1))
+    {
+        // Поток уже идёт
+        return BT_GATT_ERR(BT_ATT_ERR_PROCEDURE_IN_PROGRESS);
+    }
+
+    stream_source = data[1];
+    stream_len = data[1] == BLE_STREAM_SRC_TEST ? sys_get_le32(data + 2) : 0;
+    k_sem_give(&stream_start_sem);
+    return len;
+}
+
+static void stream_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    if (value != BT_GATT_CCC_NOTIFY)
+    {
+        atomic_clear(&stream_run);
+    }
+}
+
+BT_GATT_SERVICE_DEFINE(stream_svc,
+                       BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_16(0xABE0)),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABE1),
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                                              read_stream_ctrl, write_stream_ctrl, NULL),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_16(0xABE2),
+                                              BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_NONE,
+                                              NULL, NULL, NULL),
+                       BT_GATT_CCC(stream_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+// ==================== Поток передачи ====================
+
+// Байт в buf, 0 - конец, -EAGAIN - источник временно занят
+static int stream_fill(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    if (stream_source == BLE_STREAM_SRC_TELEMETRY)
+    {
+        return telemetry_read(offset, buf, len);
+    }
+
+    len = MIN(len, stream_len - offset);
+    for (uint32_t i = 0; i < len; i++)
+    {
+        buf[i] = (uint8_t)(offset + i);
+    }
+    return len;
+}
+
+/**
+ * @brief Передать источник целиком, конвейером по кредитам
+ * @return 0 - источник закончился, иначе ошибка
+ */
+static int stream_transfer(struct bt_conn *conn, const struct bt_gatt_attr *attr)
+{
+    struct bt_gatt_notify_params params = {
+        .attr = attr,
+        .func = stream_sent,
+    };
+    uint32_t offset = 0;
+    int err = 0;
+
+    while (atomic_get(&stream_run))
+    {
+        if (k_sem_take(&stream_credits, K_NO_WAIT) != 0)
+        {
+            stream_stats.stalls++;
+            if (k_sem_take(&stream_credits, K_MSEC(STREAM_CREDIT_TIMEOUT_MS)) != 0)
+            {
+                return -ETIMEDOUT;
+            }
+        }
+
+        // MTU мог вырасти после старта
+        int n = stream_fill(offset, stream_chunk, MIN(bt_gatt_get_mtu(conn) - 3, sizeof(stream_chunk)));
+
+        if (n == -EAGAIN)
+        {
+            // Журнал пишется во flash - подождать, кредит не расходуется
+            k_sem_give(&stream_credits);
+            k_sleep(K_MSEC(TELEM_READ_TIMEOUT_MS));
+            continue;
+        }
+
+        // n == 0 - пустое уведомление, конец потока
+        params.data = stream_chunk;
+        params.len = n;
+        err = bt_gatt_notify_cb(conn, &params);
+        if (err == -ENOMEM)
+        {
+            // Кончились буферы стека при свободном кредите - подождать
+            k_sem_give(&stream_credits);
+            k_sleep(K_MSEC(1));
+            continue;
+        }
+        if (err)
+        {
+            k_sem_give(&stream_credits);
+            return err;
+        }
+
+        if (n == 0)
+        {
+            return 0;
+        }
+        offset += n;
+        stream_stats.bytes = offset;
+    }
+    return -ECANCELED;
+}
+
+static void stream_thread(void)
+{
+    const struct bt_gatt_attr *attr =
+        bt_gatt_find_by_uuid(stream_svc.attrs, stream_svc.attr_count, BT_UUID_DECLARE_16(0xABE2));
+
+    for (;;)
+    {
+        k_sem_take(&stream_start_sem, K_FOREVER);
+
+        struct bt_conn *conn = stream_conn ? bt_conn_ref(stream_conn) : NULL;
+        if (!conn || !bt_gatt_is_subscribed(conn, attr, BT_GATT_CCC_NOTIFY))
+        {
+            atomic_clear(&stream_run);
+            if (conn)
+            {
+                bt_conn_unref(conn);
+            }
+            continue;
+        }
+
+        stream_stats.active = 1;
+        stream_stats.source = stream_source;
+        stream_stats.bytes = 0;
+        stream_set_fast(conn, true);
+
+        uint32_t start = k_uptime_get_32();
+        int err = stream_transfer(conn, attr);
+        uint32_t ms = MAX(k_uptime_get_32() - start, 1);
+
+        /*
+         * Дождаться подтверждения уведомлений в полёте, но не дольше
+         * STREAM_CREDIT_TIMEOUT_MS на все вместе. В скорость не входит.
+         */
+        int64_t drain_end = k_uptime_get() + STREAM_CREDIT_TIMEOUT_MS;
+        for (int i = 0; i < STREAM_CREDITS; i++)
+        {
+            int64_t left = drain_end - k_uptime_get();
+
+            if (left <= 0 || k_sem_take(&stream_credits, K_MSEC(left)) != 0)
+            {
+                break;
+            }
+        }
+        k_sem_reset(&stream_credits);
+        for (int i = 0; i < STREAM_CREDITS; i++)
+        {
+            k_sem_give(&stream_credits);
+        }
+
+        if (err && err != -ECANCELED)
+        {
+            stream_stats.errors++;
+        }
+        else
+        {
+            stream_stats.bytes_per_s = (uint64_t)stream_stats.bytes * 1000 / ms;
+        }
+        printk("BLE stream: %u bytes in %u ms, %u B/s (%d)\n", stream_stats.bytes, ms,
+               (uint32_t)((uint64_t)stream_stats.bytes * 1000 / ms), err);
+
+        if (stream_conn == conn)
+        {
+            stream_set_fast(conn, false);
+        }
+        bt_conn_unref(conn);
+        stream_stats.active = 0;
+        atomic_clear(&stream_run);
+    }
+}
+
+K_THREAD_DEFINE(stream_tid, STREAM_STACK_SIZE, stream_thread, NULL, NULL, NULL, STREAM_PRIORITY, 0, 0);
+
+void ble_stream_get_stats(ble_stream_stats_t *stats)
+{
+    *stats = stream_stats;
+}
@@ -0,0 +1,44 @@
+#ifndef BLE_STREAM_H_
+#define BLE_STREAM_H_
+
+#include <stdint.h>
+
+/*
+ * Потоковая передача больших объёмов по BLE (сервис 0xABE0).
+ *
+ * На время передачи соединение переводится в быстрый режим: 2M PHY,
+ * DLE до 251 байта, короткий интервал без латентности, большой ATT MTU.
+ * После - обратно в экономичные параметры (MTU остаётся: обмен MTU
+ * возможен один раз за соединение и на потребление не влияет).
+ *
+ * 0xABE1 запись: [команда][источник][длина LE32, только для TEST]
+ *        чтение: ble_stream_stats_t
+ * 0xABE2 уведомления с данными подряд, конец потока - пустое уведомление.
+ *
+ * Уведомления идут конвейером: в полёте до BLE_STREAM_CREDITS штук,
+ * кредит возвращается колбэком отправки стека.
+ */
+
+#define BLE_STREAM_CMD_STOP 0
+#define BLE_STREAM_CMD_START 1
+
+#define BLE_STREAM_SRC_TELEMETRY 1 // журнал телеметрии, как 0xABD4
+#define BLE_STREAM_SRC_TEST 2      // счётчик байт, для измерения скорости
+
+typedef struct __attribute__((packed))
+{
+    uint8_t active;
+    uint8_t source;
+    uint16_t mtu;        // ATT MTU соединения
+    uint16_t tx_octets;  // DLE, байт PDU
+    uint8_t tx_phy;      // BT_GAP_LE_PHY_*
+    uint8_t reserved;
+    uint32_t bytes;      // передано в последнем/текущем потоке
+    uint32_t bytes_per_s; // скорость последнего завершённого потока
+    uint32_t stalls;     // ожиданий кредита: все уведомления в полёте
+    uint32_t errors;
+} ble_stream_stats_t;
+
+void ble_stream_get_stats(ble_stream_stats_t *stats);
+
+#endif /* BLE_STREAM_H_ */
@@ -1,188 +1,186 @@
 #include "define.h"
+#include "dlog.h"
+#include "motor_cmd.h"
 
 #define BUTTON_NODE DT_ALIAS(sw0)
 
-#define DOUBLE_CLICK_TIMEOUT_MS 500
-#define LONG_PRESS_TIMEOUT_MS 2000
-#define DEBOUNCE_TIME_MS 50
+#define DUTY_STEP_PCT 10 // шаг скважности на импульс удержания
 
 // ==================== Глобальные переменные ====================
 const struct gpio_dt_spec button = GPIO_DT_SPEC_GET(BUTTON_NODE, gpios);
 struct gpio_callback button_cb_data;
 
-button_state_t button_state = {0};
-
-extern uint8_t duty_cycle;
-extern bool motor_on;
-extern bool pwm_active;
-
 uButton b(button);
 
-extern "C" void buttonLoop()
-{
-    // if (b.tick())
-    // {
-    //     if (b.press())
-    //         printk("Press\n");
-    //     if (b.click())
-    //         printk("Click\n");
-    //     if (b.hold())
-    //         printk("Hold\n");
-    //     if (b.releaseHold())
-    //         printk("ReleaseHold\n");
-    //     if (b.step())
-    //         printk("Step\n");
-    //     if (b.releaseStep())
-    //         printk("releaseStep\n");
-    //     if (b.release())
-    //         printk("Release\n");
-    //     if (b.hasClicks())
-    //     {
-    //         printk("Clicks: %d\n", b.getClicks());
-    //     }
-    //     if (b.timeout())
-    //         printk("Timeout\n");
-    // }
-
-    b.tick();
-
-
-    if (b.press())
-        printk("Press\n");
-    if (b.click())
-        printk("Click\n");
-    if (b.hold())
-        printk("Hold\n");
-    if (b.releaseHold())
-        printk("ReleaseHold\n");
-    if (b.step())
-        printk("Step\n");
-    if (b.releaseStep())
-        printk("releaseStep\n");
-    if (b.release())
-        printk("Release\n");
-    if (b.hasClicks())
-    {
-        printk("Clicks: %d\n", b.getClicks());
-    }
-    if (b.timeout())
-        printk("Timeout\n");
-
+// Автомат кнопки крутится по фронтам и срокам, без периодического опроса
+static struct k_work_delayable button_work;
 
+// ==================== Обработка кнопки ====================
+// Мотором управляет поток-владелец (motor_cmd.h), здесь только команды
+static void single_click_handler(void)
+{
+    DLOG_INF("Single click\n");
+    motor_cmd_post(MOTOR_CMD_TOGGLE, 0, MOTOR_CMD_F_SAVE);
 }
 
+static void double_click_handler(void)
+{
+    DLOG_INF("Double click: duty 50%%\n");
+    motor_cmd_post(MOTOR_CMD_DUTY16, MOTOR_PCT_TO_DUTY16(50), MOTOR_CMD_F_SAVE);
+}
 
-
-
-
-
-
+// Удержание включает мотор, дальше импульсы меняют скважность
 static void long_press_handler(void)
 {
-    printk("\nДолгое нажатие\n");
-
-    // if (motor_on)
-    // {
-    //     for (int i = 0; i <= 100; i += 10)
-    //     {
-    //         motor_set_pwm(i);
-    //         k_sleep(K_MSEC(100));
-    //     }
-    //     for (int i = 100; i >= 0; i -= 10)
-    //     {
-    //         motor_set_pwm(i);
-    //         k_sleep(K_MSEC(100));
-    //     }
-    //     motor_set_pwm(duty_cycle);
-    // }
+    DLOG_INF("Long press\n");
+    if (!global_motor_on)
+    {
+        motor_cmd_post(MOTOR_CMD_RUN, 1, 0);
+    }
 }
 
-// Work handlers
-void double_click_timeout_work(struct k_work *work)
+static void duty_up_handler(void)
 {
-    button_state.waiting_for_second_click = false;
-    single_click_handler();
+    motor_cmd_post(MOTOR_CMD_DUTY_STEP, DUTY_STEP_PCT, 0);
 }
 
-// GPIO ISR
-extern "C" void button_isr(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+static void duty_down_handler(void)
 {
+    motor_cmd_post(MOTOR_CMD_DUTY_STEP, -DUTY_STEP_PCT, 0);
+}
 
-    printk(BOLD FG(82) "\n%lld: Button ISR \033[0m %d\n", k_uptime_get(), gpio_pin_get_dt(&button));
+// Скважность сохраняется один раз, когда кнопку отпустили после импульсов
+static void duty_save_handler(void)
+{
+    motor_cmd_post(MOTOR_CMD_SAVE, 0, MOTOR_CMD_F_SAVE);
+}
 
-    // int64_t now = k_uptime_get();
-    // int button_value = gpio_pin_get_dt(&button);
-    // printk(RESET "Now %lld pin: %d\n " RESET, now, button_value);
+// Следующий шаблон по кругу, после последнего - стоп
+static void next_pattern_handler(void)
+{
+    DLOG_INF("Next pattern\n");
+    motor_cmd_post(MOTOR_CMD_PATTERN, MOTOR_PATTERN_NEXT, 0);
+}
 
-    //b.tick();
+// ==================== Таблица жестов ====================
+/*
+ * (событие автомата, число кликов) -> обработчик.
+ * Клики перед удержанием дают комбинации: клик + удержание приходит
+ * как Hold/Step с clicks == 1. Таблица разворачивается при компиляции
+ * в массив [событие][клики], разбор - один индекс на смену состояния.
+ */
+#define GESTURE_ANY_CLICKS 0xFF
+#define GESTURE_MAX_CLICKS 3 // больше кликов попадает в строку GESTURE_MAX_CLICKS
+#define GESTURE_EVENTS ((uint8_t)uButtonState::Timeout + 1)
 
-    // buttonLoop();
+typedef void (*gesture_handler_t)(void);
 
-    // if (button_value == 1)
-    // {
-    //     // Кнопка нажата
-    //     int64_t time_since_last = now - button_state.last_press_time;
+struct gesture_t
+{
+    uButtonState event;
+    uint8_t clicks;
+    gesture_handler_t handler;
+};
+
+static constexpr gesture_t gestures[] = {
+    {uButtonState::Clicks, 1, single_click_handler},
+    {uButtonState::Clicks, 2, double_click_handler},
+    {uButtonState::Hold, 0, long_press_handler},
+    {uButtonState::Step, 0, duty_up_handler},           // удержание: скважность вверх
+    {uButtonState::Step, 1, duty_down_handler},         // клик + удержание: вниз
+    {uButtonState::ReleaseStep, GESTURE_ANY_CLICKS, duty_save_handler},
+    {uButtonState::Hold, 2, next_pattern_handler},      // двойной клик + удержание
+};
+
+struct gesture_table_t
+{
+    gesture_handler_t handler[GESTURE_EVENTS][GESTURE_MAX_CLICKS + 1];
+};
 
-    //     if (time_since_last < DEBOUNCE_TIME_MS)
-    //     {
-    //         return; // Debounce
-    //     }
+static constexpr gesture_table_t gesture_table_build()
+{
+    gesture_table_t t{};
 
-    //     button_state.is_pressed = true;
-    //     button_state.press_start_time = now;
-    //     button_state.long_press_triggered = false;
+    // Сначала привязки на любое число кликов, точные - поверх
+    for (const gesture_t &g : gestures)
+    {
+        if (g.clicks == GESTURE_ANY_CLICKS)
+        {
+            for (uint8_t c = 0; c <= GESTURE_MAX_CLICKS; c++)
+            {
+                t.handler[(uint8_t)g.event][c] = g.handler;
+            }
+        }
+    }
+    for (const gesture_t &g : gestures)
+    {
+        if (g.clicks != GESTURE_ANY_CLICKS)
+        {
+            t.handler[(uint8_t)g.event][g.clicks] = g.handler;
+        }
+    }
+    return t;
+}
 
-    //     k_work_reschedule(&button_state.long_press_check,
-    //                       K_MSEC(LONG_PRESS_TIMEOUT_MS));
+static constexpr bool gestures_valid()
+{
+    for (const gesture_t &g : gestures)
+    {
+        if (g.clicks > GESTURE_MAX_CLICKS && g.clicks != GESTURE_ANY_CLICKS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    //     if (button_state.waiting_for_second_click)
-    //     {
-    //         k_work_cancel_delayable(&button_state.double_click_timeout);
-    //         button_state.waiting_for_second_click = false;
-    //         double_click_handler();
-    //     }
-    // }
-    // else
-    // {
-    //     // Кнопка отпущена
-    //     button_state.is_pressed = false;
-    //     int64_t press_duration = now - button_state.press_start_time;
+static_assert(gestures_valid(), "gesture click count exceeds GESTURE_MAX_CLICKS");
 
-    //     k_work_cancel_delayable(&button_state.long_press_check);
+static constexpr gesture_table_t gesture_table = gesture_table_build();
 
-    //     if (!button_state.long_press_triggered && press_duration < LONG_PRESS_TIMEOUT_MS)
-    //     {
-    //         button_state.waiting_for_second_click = true;
-    //         k_work_reschedule(&button_state.double_click_timeout,  K_MSEC(DOUBLE_CLICK_TIMEOUT_MS));
-    //     }
+static void gesture_dispatch(uButtonState event, uint8_t clicks)
+{
+    gesture_handler_t h = gesture_table.handler[(uint8_t)event][MIN(clicks, GESTURE_MAX_CLICKS)];
 
-    //     button_state.last_press_time = now;
-    // }
+    DLOG_DBG("Button event %u clicks %u\n", (uint8_t)event, clicks);
+    if (h)
+    {
+        h();
+    }
 }
 
-void long_press_check_work(struct k_work *work)
+static void button_work_handler(struct k_work *work)
 {
-    if (button_state.is_pressed && !button_state.long_press_triggered)
+    uint32_t now = k_uptime_get_32();
+    uint32_t next;
+
+    // process() возвращается после каждой смены состояния
+    while (b.process(now))
+    {
+        gesture_dispatch(b.getState(), b.getClicks());
+    }
+
+    if (b.nextDeadline(next))
     {
-        button_state.long_press_triggered = true;
-        long_press_handler();
+        k_work_reschedule(&button_work, K_MSEC(MAX((int32_t)(next - now), 0)));
     }
 }
 
-// ==================== Обработка кнопки ====================
-void single_click_handler(void)
+extern "C" void button_init(void)
 {
-    printk("\nSingle click\n");
-    // motor_toggle();
+    k_work_init_delayable(&button_work, button_work_handler);
+
+    // Кнопка может быть нажата уже при старте
+    b.pushEdgeISR(b.readButton(), k_uptime_get_32());
+    k_work_reschedule(&button_work, K_NO_WAIT);
 }
 
-void double_click_handler(void)
+// GPIO ISR
+extern "C" void button_isr(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    printk("\nDouble двойное нажатие\n");
-    // duty_cycle = 50;
-    // if (motor_on)
-    //{
-    //     motor_set_pwm(duty_cycle);
-    // }
-    // nvs_save_settings();
+    int level = gpio_pin_get_dt(&button);
+
+    b.pushEdgeISR(level, k_uptime_get_32());
+    k_work_reschedule(&button_work, K_NO_WAIT);
+    DLOG_DBG("Button ISR %d\n", level);
 }
@@ -25,6 +25,10 @@
 
 #include "uButton.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Удобные макросы (можно положить в отдельный .h)
 #define CLRscr "\033[2J\033[H"
 #define FG(color) "\033[38;5;" #color "m"
@@ -35,49 +39,78 @@
 
 #define PWM_NODE DT_NODELABEL(pwm0)
 
-// Состояние кнопки
-typedef struct {
-    int64_t press_start_time;
-    int64_t last_press_time;
-    bool is_pressed;
-    bool waiting_for_second_click;
-    bool long_press_triggered;
-    struct k_work_delayable double_click_timeout;
-    struct k_work_delayable long_press_check;
-} button_state_t;
+// 0-100% -> 0-65535
+#define MOTOR_PCT_TO_DUTY16(pct) ((uint16_t)((uint32_t)(pct) * UINT16_MAX / 100))
+#define MOTOR_DUTY16_TO_PCT(d) ((uint8_t)(((uint32_t)(d) * 100 + UINT16_MAX / 2) / UINT16_MAX))
+
+// События главного цикла (main_events)
+// Кнопка обрабатывается своей k_work_delayable по фронтам (button.cpp)
+#define MAIN_EV_ADC BIT(0)    // готов кадр скана ADC
+#define MAIN_EV_BLE BIT(1)    // запись характеристики BLE
+#define MAIN_EV_MOTOR BIT(2)  // владелец мотора применил команды (motor_cmd.cpp)
+#define MAIN_EV_ALL (MAIN_EV_ADC | MAIN_EV_BLE | MAIN_EV_MOTOR)
 
-extern button_state_t button_state;
 
+//main.c
+extern struct k_event main_events;
 
 //storage.c
 extern int nvs_init_storage(void);
+extern int zmsSaveBlob(uint32_t id, const void *data, size_t len);
+extern int zmsReadBlob(uint32_t id, void *data, size_t len);
+
+//settings.c (кэш настроек, запись во flash отложенная)
 extern void nvs_load_settings(void);
 extern void nvs_save_settings(void);
 
 //pwm.c
-extern const struct device *pwm_dev;
+extern int motor_pwm_init(void);
 extern void motor_set_pwm(uint8_t duty);
-extern void motor_toggle(void);
+extern void motor_set_pwm16(uint16_t duty16);
+extern void motor_set_dither(bool enable);
+extern int motor_set_pwm_freq(uint32_t hz);
+extern void motor_set_ramp(uint8_t ramp);
+extern uint16_t motor_duty_to_seq(uint8_t duty);
+extern int motor_play_sequence(const uint16_t *seq, uint16_t len, uint16_t step_ms, uint16_t loops);
+extern void motor_pwm_write_duty16(uint16_t duty16);
+extern void motor_pwm_stream_acquire(void);
+extern void motor_pwm_stream_release(void);
+extern bool motor_pwm_stream_write(uint16_t duty16);
+extern void motor_pwm_stream_sync(void);
+
+//pattern.c
+extern int pattern_select(uint8_t id);
+extern int pattern_check(uint8_t id);
+extern int pattern_store(uint8_t id, const void *data, size_t len);
 
 
 //button.c 
 extern const struct gpio_dt_spec button;
 extern  struct gpio_callback button_cb_data;
-extern void double_click_handler(void);
-extern void single_click_handler(void);
-extern void long_press_check_work(struct k_work *work);
 //extern void button_isr(const struct device *dev, struct gpio_callback *cb, uint32_t pins);
-extern void double_click_timeout_work(struct k_work *work);
 
 
 //ble.c
 extern void ble_start_adv(void);
+extern void ble_status_poll(void);
 
 
 //global.c
 extern uint8_t global_duty_cycle;
+extern uint16_t global_duty16;
+extern bool global_dither;
+extern uint32_t global_pwm_freq;
 extern bool global_motor_on;
 extern bool global_pwm_active;
+extern uint8_t global_ramp;
+extern uint8_t global_pattern;
+extern uint16_t global_speed_rpm;
+extern uint32_t global_motor_run_ms;
+extern uint16_t global_vbat_mv;
+
+#ifdef __cplusplus
+}
+#endif
 
 /**
  * @}
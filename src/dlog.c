@@ -0,0 +1,181 @@
+#include "define.h"
+#include "dlog.h"
+
+#include <SEGGER_RTT.h>
+
+/*
+ * Кольцо записей из 32-битных слов, несколько производителей (ISR и потоки),
+ * один потребитель - поток dlog с самым низким приоритетом.
+ *
+ * Запись: [заголовок][метка времени][аргументы...]
+ *   заголовок = level << 28 | nargs << 24 | адрес строки формата (24 бита,
+ *   flash nRF52840 0x00000000-0x000FFFFF), метка - k_cycle_get_32().
+ *
+ * Производитель резервирует место CAS по head, пишет тело и последним -
+ * заголовок (release). Ненулевой заголовок = запись готова, потребитель
+ * обнуляет слова после чтения. Переполнение - запись отбрасывается целиком.
+ */
+#define DLOG_RING_LEN 512 // слов, степень двойки
+#define DLOG_STACK_SIZE 1024
+#define DLOG_PRIORITY K_LOWEST_APPLICATION_THREAD_PRIO
+#define DLOG_RECORD_MAX (2 + DLOG_MAX_ARGS)
+#define DLOG_ADDR_MASK 0x00FFFFFFu
+
+// DLOG_OUTPUT_TEXT: форматирует поток dlog через printk.
+// DLOG_OUTPUT_BINARY: записи как есть в RTT канал DLOG_RTT_CHANNEL,
+// декодирование на хосте: tools/dlog_decode.py <elf> <дамп канала>
+#define DLOG_OUTPUT_TEXT 0
+#define DLOG_OUTPUT_BINARY 1
+#define DLOG_OUTPUT DLOG_OUTPUT_TEXT
+#define DLOG_RTT_CHANNEL 2
+#define DLOG_RTT_BUF_SIZE 1024
+
+#if (DLOG_RING_LEN & (DLOG_RING_LEN - 1)) != 0
+#error "DLOG_RING_LEN must be a power of two"
+#endif
+
+static struct
+{
+    uint32_t data[DLOG_RING_LEN];
+    uint32_t head;    // резервируют производители (CAS)
+    uint32_t tail;    // пишет только поток dlog
+    uint32_t dropped; // записи, не поместившиеся в кольцо
+} dlog_ring;
+
+K_SEM_DEFINE(dlog_sem, 0, 1);
+
+#if DLOG_OUTPUT == DLOG_OUTPUT_BINARY
+static uint8_t dlog_rtt_buf[DLOG_RTT_BUF_SIZE];
+#endif
+
+/**
+ * @brief Положить запись в кольцо (можно из ISR)
+ */
+void dlog_write(uint32_t level, const char *fmt, const uint32_t *args, uint32_t nargs)
+{
+    uint32_t len = 2 + nargs;
+    uint32_t head = __atomic_load_n(&dlog_ring.head, __ATOMIC_RELAXED);
+    uint32_t tail;
+
+    do
+    {
+        tail = __atomic_load_n(&dlog_ring.tail, __ATOMIC_ACQUIRE);
+        if (head - tail + len > DLOG_RING_LEN)
+        {
+            __atomic_fetch_add(&dlog_ring.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&dlog_ring.head, &head, head + len, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    dlog_ring.data[(head + 1) & (DLOG_RING_LEN - 1)] = k_cycle_get_32();
+    for (uint32_t i = 0; i < nargs; i++)
+    {
+        dlog_ring.data[(head + 2 + i) & (DLOG_RING_LEN - 1)] = args[i];
+    }
+
+    __atomic_store_n(&dlog_ring.data[head & (DLOG_RING_LEN - 1)],
+                     level << 28 | nargs << 24 | ((uint32_t)fmt & DLOG_ADDR_MASK),
+                     __ATOMIC_RELEASE);
+
+    // Будить поток, только если он уже вычитал всё до этой записи
+    if (__atomic_load_n(&dlog_ring.tail, __ATOMIC_ACQUIRE) == head)
+    {
+        k_sem_give(&dlog_sem);
+    }
+}
+
+uint32_t dlog_dropped(void)
+{
+    return __atomic_load_n(&dlog_ring.dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Забрать одну готовую запись
+ * @return количество слов, 0 если готовых записей нет
+ */
+static uint32_t dlog_take(uint32_t *rec)
+{
+    uint32_t tail = dlog_ring.tail;
+
+    if (tail == __atomic_load_n(&dlog_ring.head, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+
+    uint32_t hdr = __atomic_load_n(&dlog_ring.data[tail & (DLOG_RING_LEN - 1)], __ATOMIC_ACQUIRE);
+    if (hdr == 0)
+    {
+        // Зарезервирована, но ещё не дописана
+        return 0;
+    }
+
+    uint32_t len = 2 + ((hdr >> 24) & 0x0F);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        rec[i] = dlog_ring.data[(tail + i) & (DLOG_RING_LEN - 1)];
+        dlog_ring.data[(tail + i) & (DLOG_RING_LEN - 1)] = 0;
+    }
+
+    __atomic_store_n(&dlog_ring.tail, tail + len, __ATOMIC_RELEASE);
+    return len;
+}
+
+static void dlog_output(const uint32_t *rec, uint32_t len)
+{
+#if DLOG_OUTPUT == DLOG_OUTPUT_BINARY
+    SEGGER_RTT_Write(DLOG_RTT_CHANNEL, rec, len * sizeof(uint32_t));
+#else
+    static const char level_tag[] = "?EWID";
+    uint32_t a[DLOG_MAX_ARGS] = {0};
+    const char *fmt = (const char *)(rec[0] & DLOG_ADDR_MASK);
+
+    ARG_UNUSED(len);
+    memcpy(a, &rec[2], ((rec[0] >> 24) & 0x0F) * sizeof(uint32_t));
+
+    printk("[%u %c] ", k_cyc_to_ms_floor32(rec[1]), level_tag[rec[0] >> 28]);
+    printk(fmt, a[0], a[1], a[2], a[3]);
+#endif
+}
+
+static void dlog_thread(void *p1, void *p2, void *p3)
+{
+    uint32_t rec[DLOG_RECORD_MAX];
+    uint32_t reported = 0;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+#if DLOG_OUTPUT == DLOG_OUTPUT_BINARY
+    SEGGER_RTT_ConfigUpBuffer(DLOG_RTT_CHANNEL, "dlog", dlog_rtt_buf, sizeof(dlog_rtt_buf),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+
+    while (1)
+    {
+        k_sem_take(&dlog_sem, K_FOREVER);
+
+        uint32_t len;
+        while ((len = dlog_take(rec)) != 0)
+        {
+            dlog_output(rec, len);
+        }
+
+        if (dlog_dropped() != reported)
+        {
+            reported = dlog_dropped();
+            printk("dlog: dropped %u\n", reported);
+        }
+
+        // Запись могла быть зарезервирована, но не дописана к моменту чтения
+        if (__atomic_load_n(&dlog_ring.head, __ATOMIC_ACQUIRE) != dlog_ring.tail)
+        {
+            k_sleep(K_MSEC(1));
+            k_sem_give(&dlog_sem);
+        }
+    }
+}
+
+K_THREAD_DEFINE(dlog_tid, DLOG_STACK_SIZE, dlog_thread, NULL, NULL, NULL, DLOG_PRIORITY, 0, 0);
@@ -0,0 +1,74 @@
+#ifndef DLOG_H_
+#define DLOG_H_
+
+/*
+ * Отложенный лог: в точке вызова в кольцо кладутся только адрес строки
+ * формата (она остаётся во flash) и сырые 32-битные аргументы.
+ * Форматирует поток низкого приоритета (DLOG_OUTPUT_TEXT) или хост
+ * по ELF (DLOG_OUTPUT_BINARY, tools/dlog_decode.py). Можно вызывать из ISR.
+ *
+ * Аргументы - только целые до 32 бит (%d %u %x %c), не больше DLOG_MAX_ARGS.
+ * Строки (%s) и float не поддерживаются: к моменту форматирования
+ * буфер строки может уже не существовать.
+ *
+ * Уровень отсекается при компиляции: вызовы выше DLOG_LEVEL не попадают в код.
+ * DLOG_LEVEL можно переопределить до #include "dlog.h" для одного файла.
+ */
+
+#include <stdint.h>
+
+#define DLOG_LEVEL_NONE 0
+#define DLOG_LEVEL_ERR 1
+#define DLOG_LEVEL_WRN 2
+#define DLOG_LEVEL_INF 3
+#define DLOG_LEVEL_DBG 4
+
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL DLOG_LEVEL_INF
+#endif
+
+#define DLOG_MAX_ARGS 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void dlog_write(uint32_t level, const char *fmt, const uint32_t *args, uint32_t nargs);
+uint32_t dlog_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Первый аргумент - строка формата, за ней 0..DLOG_MAX_ARGS целых.
+// Пустой __VA_ARGS__ нигде не передаётся, макросы работают и в строгом C99/C++17.
+#define DLOG_NARGS(...) DLOG_NARGS_(__VA_ARGS__, 4, 3, 2, 1, 0, _)
+#define DLOG_NARGS_(f, _1, _2, _3, _4, N, ...) N
+#define DLOG_FMT(...) DLOG_FMT_(__VA_ARGS__, _)
+#define DLOG_FMT_(f, ...) f
+#define DLOG_CAST_0(f)
+#define DLOG_CAST_1(f, a) , (uint32_t)(a)
+#define DLOG_CAST_2(f, a, b) DLOG_CAST_1(f, a) DLOG_CAST_1(f, b)
+#define DLOG_CAST_3(f, a, b, c) DLOG_CAST_2(f, a, b) DLOG_CAST_1(f, c)
+#define DLOG_CAST_4(f, a, b, c, d) DLOG_CAST_3(f, a, b, c) DLOG_CAST_1(f, d)
+#define DLOG_CAST_N_(n, ...) DLOG_CAST_##n(__VA_ARGS__)
+#define DLOG_CAST_N(n, ...) DLOG_CAST_N_(n, __VA_ARGS__)
+
+#define DLOG(level, ...)                                                                \
+    do                                                                                  \
+    {                                                                                   \
+        if ((level) <= DLOG_LEVEL)                                                      \
+        {                                                                               \
+            const uint32_t _dlog_args[] = {0 DLOG_CAST_N(DLOG_NARGS(__VA_ARGS__),       \
+                                                         __VA_ARGS__)};                 \
+            dlog_write((level), DLOG_FMT(__VA_ARGS__), _dlog_args + 1,                  \
+                       sizeof(_dlog_args) / sizeof(_dlog_args[0]) - 1);                 \
+        }                                                                               \
+    } while (0)
+
+#define DLOG_ERR(...) DLOG(DLOG_LEVEL_ERR, __VA_ARGS__)
+#define DLOG_WRN(...) DLOG(DLOG_LEVEL_WRN, __VA_ARGS__)
+#define DLOG_INF(...) DLOG(DLOG_LEVEL_INF, __VA_ARGS__)
+#define DLOG_DBG(...) DLOG(DLOG_LEVEL_DBG, __VA_ARGS__)
+
+#endif /* DLOG_H_ */
@@ -0,0 +1,291 @@
+#include "define.h"
+#include "duty_stream.h"
+#include "lockfree_ring.h"
+#include "motor_cmd.h"
+
+#include <zephyr/sys/byteorder.h>
+
+/*
+ * Производитель кольца - поток BT RX (duty_stream_put), потребитель -
+ * прерывание TIMER4. Таймер идёт всё время, пока поток активен; пока
+ * буфер копится, прерывание только ждёт.
+ *
+ * ШИМ потоку отдаёт и забирает владелец мотора (MOTOR_CMD_STREAM):
+ * BT RX готовит поток и просит START, владелец отдаёт ШИМ
+ * (motor_pwm_stream_acquire) и запускает таймер. Прерывание пишет только
+ * compare в буфер потока, конец потока - команда END владельцу.
+ */
+#define DUTY_STREAM_TIMER NRF_TIMER4
+#define DUTY_STREAM_BUF_LEN 64 // 320 мс при 200 Гц, 1.28 с при 50 Гц
+
+BUILD_ASSERT(DUTY_STREAM_PREBUF_US / DUTY_STREAM_PERIOD_MIN_US < DUTY_STREAM_BUF_LEN,
+             "prebuffer does not fit");
+
+static SpscRing<uint16_t, DUTY_STREAM_BUF_LEN> duty_ring;
+
+static struct
+{
+    // Общие с прерыванием, меняются под irq_lock
+    bool active;  // поток начат: таймер идёт или владелец его запустит
+    bool playing; // прерывание забирает отсчёты, иначе ждёт накопления
+    bool ending;  // пришёл пакет конца, доиграть буфер
+    uint16_t prebuf;
+    uint16_t idle_max; // тиков без данных до остановки
+
+    // Только прерывание
+    uint16_t idle;
+
+    // Только производитель
+    uint16_t period_us;
+    uint16_t next_seq;
+    uint16_t tail;      // последнее поставленное значение, им заполняются разрывы
+    uint32_t next_t_us; // время следующего отсчёта на часах отправителя
+    uint32_t offset_min_us;
+    uint64_t jitter_sum_us;
+} ds;
+
+static duty_stream_stats_t ds_stats;
+
+// Вернуть ШИМ владельцу (из ISR)
+static void duty_stream_finish(void)
+{
+    DUTY_STREAM_TIMER->TASKS_STOP = 1;
+    ds.active = false;
+    ds.playing = false;
+    motor_cmd_post(MOTOR_CMD_STREAM, MOTOR_STREAM_END, 0);
+}
+
+static void duty_stream_isr(const void *arg)
+{
+    NRF_TIMER_Type *timer = DUTY_STREAM_TIMER;
+    uint32_t count = duty_ring.count();
+    uint16_t v;
+
+    timer->EVENTS_COMPARE[0] = 0;
+
+    if (!ds.active)
+    {
+        return; // остановлен, прерывание уже висело
+    }
+
+    if (!ds.playing)
+    {
+        if (count < ds.prebuf && !(ds.ending && count))
+        {
+            // Копим; без данных слишком долго - поток закончился
+            if (count == 0 && ++ds.idle >= ds.idle_max)
+            {
+                duty_stream_finish();
+            }
+            return;
+        }
+        ds.playing = true;
+    }
+
+    if (!duty_ring.pop(v))
+    {
+        if (ds.ending)
+        {
+            duty_stream_finish();
+            return;
+        }
+        // Опустошение: держим последнее значение до нового накопления
+        ds_stats.underruns++;
+        ds.playing = false;
+        ds.idle = 0;
+        return;
+    }
+
+    ds.idle = 0;
+    ds_stats.depth_min = MIN(ds_stats.depth_min, count - 1);
+    if (motor_pwm_stream_write(v))
+    {
+        motor_cmd_post(MOTOR_CMD_STREAM, MOTOR_STREAM_SYNC, 0);
+    }
+}
+
+// Новый поток (BT RX): состояние и кольцо, таймер запустит владелец
+static int duty_stream_start(uint16_t period_us)
+{
+    uint16_t v;
+
+    // Потребитель стоит - остатки прошлого потока можно выбросить отсюда
+    while (duty_ring.pop(v))
+    {
+    }
+
+    unsigned int key = irq_lock();
+    ds.period_us = period_us;
+    ds.prebuf = MAX(DUTY_STREAM_PREBUF_US / period_us, 1);
+    ds.idle_max = DUTY_STREAM_IDLE_US / period_us;
+    ds.idle = 0;
+    ds.playing = false;
+    ds.ending = false;
+    ds.active = true;
+    ds_stats.depth_min = UINT16_MAX;
+    irq_unlock(key);
+
+    // Регулятор скорости и шаблон отпустят ШИМ в потоке владельца
+    int err = motor_cmd_post(MOTOR_CMD_STREAM, MOTOR_STREAM_START, 0);
+    if (err)
+    {
+        ds.active = false;
+    }
+    return err;
+}
+
+extern "C" void duty_stream_begin(void)
+{
+    NRF_TIMER_Type *timer = DUTY_STREAM_TIMER;
+
+    if (!ds.active)
+    {
+        return; // владелец уже остановил поток своей командой
+    }
+
+    motor_pwm_stream_acquire();
+
+    // 1 МГц, сброс по COMPARE[0]
+    unsigned int key = irq_lock();
+    timer->TASKS_STOP = 1;
+    timer->MODE = TIMER_MODE_MODE_Timer;
+    timer->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    timer->PRESCALER = 4; // 16 МГц / 2^4
+    timer->CC[0] = ds.period_us;
+    timer->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    timer->EVENTS_COMPARE[0] = 0;
+    timer->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+    timer->TASKS_CLEAR = 1;
+    timer->TASKS_START = 1;
+    irq_unlock(key);
+}
+
+extern "C" int duty_stream_put(const void *buf, uint16_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+
+    if (len < sizeof(duty_stream_hdr_t) || (len - sizeof(duty_stream_hdr_t)) % 2)
+    {
+        return -EINVAL;
+    }
+
+    uint16_t seq = sys_get_le16(p + offsetof(duty_stream_hdr_t, seq));
+    uint32_t t_us = sys_get_le32(p + offsetof(duty_stream_hdr_t, t_us));
+    uint16_t period_us = sys_get_le16(p + offsetof(duty_stream_hdr_t, period_us));
+    uint16_t n = (len - sizeof(duty_stream_hdr_t)) / 2;
+    uint32_t now_us = k_ticks_to_us_floor32(k_uptime_ticks());
+
+    p += sizeof(duty_stream_hdr_t);
+
+    if (!ds.active)
+    {
+        if (n == 0)
+        {
+            return 0;
+        }
+        if (period_us < DUTY_STREAM_PERIOD_MIN_US || period_us > DUTY_STREAM_PERIOD_MAX_US)
+        {
+            return -EINVAL;
+        }
+        ds.next_seq = seq;
+        ds.next_t_us = t_us;
+        ds.offset_min_us = now_us - t_us;
+        ds.tail = sys_get_le16(p);
+        int err = duty_stream_start(period_us);
+        if (err)
+        {
+            return err;
+        }
+    }
+    else if (period_us != ds.period_us)
+    {
+        return -EINVAL;
+    }
+
+    if (n == 0)
+    {
+        ds.ending = true;
+        return 0;
+    }
+    ds.ending = false;
+    ds_stats.batches++;
+
+    // Потерянные пакеты (seq идёт по модулю 2^16, повтор старого не считается)
+    int16_t lost = (int16_t)(seq - ds.next_seq);
+    if (lost > 0)
+    {
+        ds_stats.lost += lost;
+    }
+    ds.next_seq = seq + 1;
+
+    // Джиттер - задержка доставки сверх самой быстрой за поток
+    uint32_t offset = now_us - t_us;
+    int32_t jitter = (int32_t)(offset - ds.offset_min_us);
+    if (jitter < 0)
+    {
+        ds.offset_min_us = offset;
+        jitter = 0;
+    }
+    ds_stats.jitter_max_us = MAX(ds_stats.jitter_max_us, (uint32_t)jitter);
+    ds.jitter_sum_us += jitter;
+    ds_stats.jitter_avg_us = ds.jitter_sum_us / ds_stats.batches;
+
+    // Выравнивание по времени отправителя: разрыв - повтор, перекрытие - пропуск
+    int32_t dt = (int32_t)(t_us - ds.next_t_us);
+    uint16_t skip = 0;
+
+    if (dt >= period_us)
+    {
+        for (int32_t i = dt / period_us; i > 0 && duty_ring.push(ds.tail); i--)
+        {
+            ds_stats.gap_filled++;
+        }
+    }
+    else if (dt <= -(int32_t)period_us)
+    {
+        skip = MIN((uint32_t)(-dt) / period_us, n);
+        ds_stats.late += skip;
+    }
+    ds.next_t_us = t_us + n * period_us;
+
+    for (uint16_t i = skip; i < n; i++)
+    {
+        uint16_t v = sys_get_le16(p + 2 * i);
+
+        if (!duty_ring.push(v))
+        {
+            ds_stats.overruns += n - i;
+            break;
+        }
+        ds.tail = v;
+        ds_stats.samples++;
+    }
+    return 0;
+}
+
+extern "C" void duty_stream_stop(void)
+{
+    unsigned int key = irq_lock();
+    if (ds.active)
+    {
+        DUTY_STREAM_TIMER->TASKS_STOP = 1;
+        ds.active = false;
+        ds.playing = false;
+    }
+    irq_unlock(key);
+
+    // И после конца потока из прерывания: ШИМ ещё у потока
+    motor_pwm_stream_release();
+}
+
+extern "C" void duty_stream_get_stats(duty_stream_stats_t *stats)
+{
+    *stats = ds_stats;
+}
+
+extern "C" int duty_stream_init(void)
+{
+    IRQ_CONNECT(TIMER4_IRQn, 2, duty_stream_isr, NULL, 0);
+    irq_enable(TIMER4_IRQn);
+    return 0;
+}
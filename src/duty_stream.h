@@ -0,0 +1,79 @@
+#ifndef DUTY_STREAM_H_
+#define DUTY_STREAM_H_
+
+/*
+ * Поток уставок скважности с телефона (duty_stream.cpp), 50-200 Гц.
+ *
+ * Пакеты приходят записью без ответа (BLE 0xABD8):
+ *   duty_stream_hdr_t, затем N x duty16 LE - отсчёты с шагом period_us,
+ *   первый отсчёт соответствует t_us на часах отправителя.
+ * Пакет без отсчётов - конец потока: буфер доигрывается и мотор
+ * возвращается к состоянию владельца (motor_cmd.h).
+ *
+ * Джиттер-буфер: отсчёты копятся в SPSC кольце, TIMER4 забирает их с
+ * постоянным шагом и пишет compare в буфер ШИМ, который владелец мотора
+ * отдал потоку (MOTOR_CMD_STREAM). Воспроизведение
+ * начинается, когда в буфере DUTY_STREAM_PREBUF_US; при опустошении
+ * держится последнее значение до нового накопления.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DUTY_STREAM_PERIOD_MIN_US 5000  // 200 Гц
+#define DUTY_STREAM_PERIOD_MAX_US 20000 // 50 Гц
+#define DUTY_STREAM_PREBUF_US 40000     // задержка воспроизведения
+#define DUTY_STREAM_IDLE_US 250000      // нет данных дольше - поток закончен
+
+typedef struct __attribute__((packed))
+{
+    uint16_t seq;       // номер пакета, пропуски считаются в lost
+    uint32_t t_us;      // время первого отсчёта у отправителя
+    uint16_t period_us; // шаг отсчётов, одинаковый на весь поток
+} duty_stream_hdr_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t batches;
+    uint32_t samples;
+    uint16_t lost;        // пропущенных пакетов по seq
+    uint16_t late;        // отсчётов, пришедших после уже поставленных
+    uint16_t gap_filled;  // отсчётов, досыпанных повтором по разрыву во времени
+    uint16_t overruns;    // отсчётов, не поместившихся в буфер
+    uint16_t underruns;   // опустошений буфера во время воспроизведения
+    uint16_t depth_min;   // минимум заполнения буфера, отсчётов
+    uint32_t jitter_max_us; // задержка доставки пакета сверх минимальной
+    uint32_t jitter_avg_us;
+} duty_stream_stats_t;
+
+int duty_stream_init(void);
+
+/**
+ * @brief Принять пакет отсчётов (поток BT RX)
+ * @return 0, -EINVAL при неверном пакете, -ENOBUFS - очередь команд
+ *         мотору полна, поток не начат
+ */
+int duty_stream_put(const void *buf, uint16_t len);
+
+/**
+ * @brief Отдать ШИМ потоку и запустить воспроизведение (владелец мотора,
+ *        MOTOR_STREAM_START)
+ */
+void duty_stream_begin(void);
+
+/**
+ * @brief Остановить воспроизведение и забрать ШИМ у потока (владелец
+ *        мотора перед своей командой)
+ */
+void duty_stream_stop(void);
+
+void duty_stream_get_stats(duty_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DUTY_STREAM_H_ */
@@ -1,29 +1,18 @@
 #include "define.h"
 
-#include <zephyr/fs/zms.h>
-
-extern struct zms_fs zms;
-
-extern int zmsSave(uint32_t id, uint8_t data);
-extern int zmsRead(uint32_t id, uint8_t *data, uint8_t define);
-
 bool global_cpu_active = false;
 
 bool global_motor_on = false;
 bool global_pwm_active = false;
 
-uint8_t global_duty_cycle = 50;
-
-#define NVS_ID_DUTY_CYCLE 1
-#define NVS_ID_MOTOR_STATE 2
-
-//-------------------------------
-void saveDutyCycle()
-{
-    zmsSave(NVS_ID_DUTY_CYCLE, global_duty_cycle);
-}
-//-------------------------------
-void readDutyCycle()
-{
-    zmsRead(NVS_ID_DUTY_CYCLE, &global_duty_cycle, 50);
-}
+// Настройки: диапазоны и умолчания - в реестре (settings_registry.cpp)
+uint8_t global_duty_cycle;  // производная от global_duty16, 0-100%
+uint16_t global_duty16;     // скважность 16 бит, 65535 = 100%
+bool global_dither;         // сглаживание дробной части compare
+uint32_t global_pwm_freq;   // частота ШИМ, Гц
+uint8_t global_ramp;        // профиль разгона pwm_ramp_t
+
+uint8_t global_pattern = 0;            // играющий шаблон, 0 - нет
+uint16_t global_speed_rpm = 0;         // уставка замкнутого контура, 0 - разомкнутый
+uint32_t global_motor_run_ms = 0;      // наработка мотора за этот запуск
+uint16_t global_vbat_mv = 0;           // последнее измерение батареи
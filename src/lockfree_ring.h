@@ -0,0 +1,148 @@
+#ifndef LOCKFREE_RING_H_
+#define LOCKFREE_RING_H_
+
+/*
+ * Lock-free кольца фиксированного размера для C++ (только заголовок).
+ * Не зависят от Zephyr/nrfx, собираются и на хосте.
+ *
+ *  SpscRing<T, N> - один производитель, один потребитель (как sample_ring.h)
+ *  MpscRing<T, N> - несколько производителей (потоки и ISR), один потребитель
+ *
+ * N - степень двойки. T копируется присваиванием, держите его маленьким.
+ * Ожидания нет: push() при заполнении и pop() при пустом кольце сразу
+ * возвращают false, будить потребителя - забота вызывающего.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    bool push(const T &v)
+    {
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+
+        if (head - tail == N)
+        {
+            return false;
+        }
+        data_[head & (N - 1)] = v;
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool pop(T &v)
+    {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+
+        if (head == tail)
+        {
+            return false;
+        }
+        v = data_[tail & (N - 1)];
+        __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    uint32_t count() const
+    {
+        return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    }
+
+private:
+    T data_[N];
+    uint32_t head_ = 0; // пишет только производитель
+    uint32_t tail_ = 0; // пишет только потребитель
+};
+
+/*
+ * У каждой ячейки свой номер seq:
+ *  seq == pos      - ячейка свободна для записи с позиции pos
+ *  seq == pos + 1  - данные позиции pos записаны, можно читать
+ *  seq == pos + N  - прочитана, свободна для следующего круга
+ * Производители делят позицию записи через CAS, потребитель один и
+ * двигает позицию чтения без атомарных RMW.
+ *
+ * Если производителя вытеснили между CAS и публикацией seq, pop()
+ * вернёт false до окончания его записи, даже если следующие ячейки
+ * уже готовы: порядок сохраняется, производитель потом разбудит
+ * потребителя сам.
+ */
+template <typename T, size_t N>
+class MpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    MpscRing()
+    {
+        for (uint32_t i = 0; i < N; i++)
+        {
+            slots_[i].seq = i;
+        }
+    }
+
+    bool push(const T &v)
+    {
+        uint32_t pos = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+
+        for (;;)
+        {
+            Slot &s = slots_[pos & (N - 1)];
+            int32_t dif = (int32_t)(__atomic_load_n(&s.seq, __ATOMIC_ACQUIRE) - pos);
+
+            if (dif == 0)
+            {
+                // pos обновится при неудаче
+                if (__atomic_compare_exchange_n(&head_, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED))
+                {
+                    s.value = v;
+                    __atomic_store_n(&s.seq, pos + 1, __ATOMIC_RELEASE);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+            {
+                return false; // полно
+            }
+            else
+            {
+                pos = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    bool pop(T &v)
+    {
+        Slot &s = slots_[tail_ & (N - 1)];
+
+        if (__atomic_load_n(&s.seq, __ATOMIC_ACQUIRE) != tail_ + 1)
+        {
+            return false;
+        }
+        v = s.value;
+        __atomic_store_n(&s.seq, tail_ + N, __ATOMIC_RELEASE);
+        tail_++;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t seq;
+        T value;
+    };
+
+    Slot slots_[N];
+    uint32_t head_ = 0; // позиция записи, общая для производителей
+    uint32_t tail_ = 0; // позиция чтения, только потребитель
+};
+
+#endif /* LOCKFREE_RING_H_ */
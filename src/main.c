@@ -1,15 +1,25 @@
 #include "define.h"
 #include <zephyr/logging/log.h>
+#include "adc.h"
+#include "dlog.h"
+#include "pof_snapshot.h"
+#include "settings_registry.h"
+#include "duty_stream.h"
+
+#include <stdlib.h>
 
 //"NRF52832_XXAA"
 // JLinkGDBServer -device NRF52832_XXAA -if SWD -speed 6000 -autoconnect 1 -nogui
 
 extern void button_isr();
+extern void button_init(void);
+
+// Главный цикл спит до событий от кнопки, ADC и BLE
+K_EVENT_DEFINE(main_events);
 
-extern void buttonLoop();
+static uint32_t main_wakeups;
 
-extern int adc_init(void);
-extern int16_t adc_read_registers(void);
+#define MAIN_VBAT_LOG_STEP_MV 50 // Vbat в лог только при заметном изменении
 
 int main(void)
 {
@@ -52,6 +62,15 @@ int main(void)
 
     adc_init();
 
+    // Непрерывный скан каналов ADC_CHANNELS, main только забирает готовые отсчёты.
+    // Мотор стоит - редкий скан, быстрый включает владелец мотора вместе с ШИМ
+    adc_stream_notify(&main_events, MAIN_EV_ADC);
+    err = adc_stream_start(ADC_SCAN_IDLE_PERIOD_US, NULL);
+    if (err)
+    {
+        printk("ADC stream start failed: %d\n", err);
+    }
+
     // // Настройка выходов P0.10 и P0.29
     // nrf_gpio_cfg_output(10);
     // nrf_gpio_pin_set(10);
@@ -61,6 +80,9 @@ int main(void)
     // nrf_gpio_pin_set(29);
     // printk("P0.29 set HIGH\n");
 
+    // Умолчания всех настроек, дальше их перекроет загрузка из flash
+    settings_registry_defaults();
+
     // Инициализация NVS
     err = nvs_init_storage();
     if (err)
@@ -69,16 +91,18 @@ int main(void)
     }
     else
     {
-        // nvs_load_settings();
+        nvs_load_settings();
+        pof_snapshot_arm();
     }
 
     // Инициализация PWM
-    pwm_dev = DEVICE_DT_GET(PWM_NODE);
-    if (!device_is_ready(pwm_dev))
+    err = motor_pwm_init();
+    if (err)
     {
-        printk("PWM device not ready\n");
+        printk("PWM init failed\n");
         return -1;
     }
+    duty_stream_init();
 
     // // Выключить PWM изначально
     motor_set_pwm(0);
@@ -104,13 +128,10 @@ int main(void)
         return -1;
     }
 
+    button_init();
     gpio_init_callback(&button_cb_data, button_isr, BIT(button.pin));
     gpio_add_callback(button.port, &button_cb_data);
 
-    // Инициализация delayed works
-    //    k_work_init_delayable(&button_state.double_click_timeout, double_click_timeout_work);
-    //    k_work_init_delayable(&button_state.long_press_check, long_press_check_work);
-
     printk("Button configured\n");
 
     // Инициализация Bluetooth
@@ -134,18 +155,60 @@ int main(void)
     // pm_policy_state_lock_put(PM_STATE_STANDBY, PM_ALL_SUBSTATES);
     // pm_policy_state_lock_put(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
 
-    // Main loop - просто спим, всё управляется прерываниями
+    // Main loop - спим до события
+    uint32_t wakeups_mark = 0;
+    uint32_t wakeups_mark_ms = k_uptime_get_32();
+    uint32_t run_mark_ms = wakeups_mark_ms;
+    int vbat_logged_mv = 0;
+    uint32_t overruns_logged = 0;
+
     while (1)
     {
-        int raw = adc_read_registers();
-        float Vbat = raw * 0.6 * 5 / 4096;
-        printk("\n" FG(51) "► raw: %d Vbat = %.3f" RESET, raw, Vbat);
-        buttonLoop();
-        // printk("\r" FG(51) "► Uptime: %6u сек" RESET, k_uptime_get_32() / 1000);
-        k_sleep(K_MSEC(20));
-
-        // k_sleep(K_FOREVER);
-        //  k_sleep(K_SECONDS(1));
+        uint32_t events = k_event_wait(&main_events, MAIN_EV_ALL, false, K_FOREVER);
+
+        // Сброс до обработки: событие, пришедшее во время обработки, не теряется
+        k_event_clear(&main_events, events);
+        main_wakeups++;
+        ble_status_poll();
+
+        // Наработка мотора для снимка POFWARN
+        uint32_t run_now = k_uptime_get_32();
+        if (global_pwm_active)
+        {
+            global_motor_run_ms += run_now - run_mark_ms;
+        }
+        run_mark_ms = run_now;
+
+        if (events & MAIN_EV_ADC)
+        {
+            int16_t samples[8];
+            size_t n = adc_stream_read(samples, ARRAY_SIZE(samples));
+            uint32_t now = k_uptime_get_32();
+            uint32_t rate = (main_wakeups - wakeups_mark) * 1000 / MAX(now - wakeups_mark_ms, 1);
+
+            wakeups_mark = main_wakeups;
+            wakeups_mark_ms = now;
+
+            if (n)
+            {
+                int raw = samples[n - 1];
+                uint32_t overruns = adc_stream_overruns();
+
+                global_vbat_mv = MAX(raw, 0) * 600 * 5 / 4096;
+                if (abs(global_vbat_mv - vbat_logged_mv) >= MAIN_VBAT_LOG_STEP_MV || overruns != overruns_logged)
+                {
+                    vbat_logged_mv = global_vbat_mv;
+                    overruns_logged = overruns;
+                    DLOG_INF("raw: %d Vbat = %d mV (overruns %u), wakeups %u/s\n", raw, global_vbat_mv, overruns,
+                             rate);
+                }
+            }
+        }
+
+        if (events & MAIN_EV_BLE)
+        {
+            DLOG_INF("BLE: motor %d, duty16 %u, pattern %u\n", global_motor_on, global_duty16, global_pattern);
+        }
     }
 
     return 0;
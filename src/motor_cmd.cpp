@@ -0,0 +1,374 @@
+#include "define.h"
+#include "motor_cmd.h"
+#include "lockfree_ring.h"
+#include "ble_conn_param.h"
+#include "dlog.h"
+#include "settings.h"
+#include "duty_stream.h"
+#include "speed_ctrl.h"
+
+#define MOTOR_CMD_STACK_SIZE 1024
+#define MOTOR_CMD_PRIORITY 2 // выше BT RX: команда применяется сразу после записи
+
+struct motor_cmd_t
+{
+    uint8_t type;
+    uint8_t flags;
+    union
+    {
+        int32_t value;
+        motor_set_t set; // MOTOR_CMD_MULTI
+    };
+    uint32_t cyc; // k_cycle_get_32() при постановке
+};
+
+static MpscRing<motor_cmd_t, MOTOR_CMD_QUEUE_LEN> motor_cmd_ring;
+static motor_cmd_stats_t motor_cmd_stats;
+
+K_SEM_DEFINE(motor_cmd_sem, 0, 1);
+
+static int motor_cmd_push(const motor_cmd_t &cmd)
+{
+    if (!motor_cmd_ring.push(cmd))
+    {
+        __atomic_fetch_add(&motor_cmd_stats.overflows, 1, __ATOMIC_RELAXED);
+        return -ENOBUFS;
+    }
+    __atomic_fetch_add(&motor_cmd_stats.posted, 1, __ATOMIC_RELAXED);
+    k_sem_give(&motor_cmd_sem);
+    return 0;
+}
+
+extern "C" int motor_cmd_post(motor_cmd_type_t type, int32_t value, uint8_t flags)
+{
+    motor_cmd_t cmd = {};
+
+    cmd.type = type;
+    cmd.flags = flags;
+    cmd.value = value;
+    cmd.cyc = k_cycle_get_32();
+    return motor_cmd_push(cmd);
+}
+
+extern "C" int motor_cmd_post_set(const motor_set_t *set, uint8_t flags)
+{
+    motor_cmd_t cmd = {};
+
+    cmd.type = MOTOR_CMD_MULTI;
+    cmd.flags = flags;
+    cmd.set = *set;
+    cmd.cyc = k_cycle_get_32();
+    return motor_cmd_push(cmd);
+}
+
+// Режим, который применит пачка: последняя команда пуска/скважности, шаблона или скорости
+enum motor_mode_t : uint8_t
+{
+    MOTOR_MODE_KEEP,    // режим не меняется
+    MOTOR_MODE_PWM,     // motor_set_pwm16() (он же отпускает регулятор скорости и шаблон)
+    MOTOR_MODE_PATTERN, // pattern_select()
+    MOTOR_MODE_SPEED,   // speed_ctrl_set_rpm()
+    MOTOR_MODE_STREAM,  // duty_stream_begin()
+};
+
+// Целевое состояние пачки команд
+struct motor_target_t
+{
+    uint16_t duty16;
+    bool on;
+    uint8_t mode;     // motor_mode_t
+    uint8_t pattern;
+    uint16_t rpm;
+    uint32_t freq;    // 0 - не менять
+    uint8_t ramp;
+    bool dither;
+    uint32_t stream_syncs; // MOTOR_STREAM_SYNC в пачке
+    bool save;
+    bool flush;
+    bool ble;
+    uint32_t ble_cyc; // самая ранняя запись BLE в пачке
+};
+
+// Шаблон / регулятор скорости работают к этому моменту пачки
+static bool motor_target_pattern(const motor_target_t &t)
+{
+    return t.mode == MOTOR_MODE_PATTERN ? t.pattern != 0 : t.mode == MOTOR_MODE_KEEP && global_pattern;
+}
+
+static bool motor_target_speed(const motor_target_t &t)
+{
+    return t.mode == MOTOR_MODE_SPEED ? t.rpm != 0 : t.mode == MOTOR_MODE_KEEP && global_speed_rpm;
+}
+
+static void motor_cmd_fold(motor_target_t &t, const motor_cmd_t &cmd);
+
+// MOTOR_CMD_MULTI: поля по очереди, как одиночные команды без флагов
+static void motor_cmd_fold_set(motor_target_t &t, const motor_set_t &set)
+{
+    motor_cmd_t one = {};
+
+    if (set.mask & MOTOR_SET_FREQ)
+    {
+        one.type = MOTOR_CMD_FREQ;
+        one.value = set.freq;
+        motor_cmd_fold(t, one);
+    }
+    if (set.mask & MOTOR_SET_RAMP)
+    {
+        one.type = MOTOR_CMD_RAMP;
+        one.value = set.ramp;
+        motor_cmd_fold(t, one);
+    }
+    if (set.mask & MOTOR_SET_DITHER)
+    {
+        one.type = MOTOR_CMD_DITHER;
+        one.value = set.dither;
+        motor_cmd_fold(t, one);
+    }
+    if ((set.mask & MOTOR_SET_DUTY16) && (set.mask & MOTOR_SET_RUN))
+    {
+        one.type = MOTOR_CMD_SET;
+        one.value = MOTOR_CMD_SET_VALUE(set.duty16, set.run);
+        motor_cmd_fold(t, one);
+    }
+    else if (set.mask & MOTOR_SET_DUTY16)
+    {
+        one.type = MOTOR_CMD_DUTY16;
+        one.value = set.duty16;
+        motor_cmd_fold(t, one);
+    }
+    else if (set.mask & MOTOR_SET_RUN)
+    {
+        one.type = MOTOR_CMD_RUN;
+        one.value = set.run;
+        motor_cmd_fold(t, one);
+    }
+    if (set.mask & MOTOR_SET_PATTERN)
+    {
+        one.type = MOTOR_CMD_PATTERN;
+        one.value = set.pattern;
+        motor_cmd_fold(t, one);
+    }
+}
+
+static void motor_cmd_fold(motor_target_t &t, const motor_cmd_t &cmd)
+{
+    switch (cmd.type)
+    {
+    case MOTOR_CMD_DUTY16:
+        t.duty16 = (uint16_t)CLAMP(cmd.value, 0, UINT16_MAX);
+        if (t.on)
+        {
+            t.mode = MOTOR_MODE_PWM;
+        }
+        break;
+    case MOTOR_CMD_DUTY_STEP:
+    {
+        int32_t pct = MOTOR_DUTY16_TO_PCT(t.duty16) + cmd.value;
+
+        t.duty16 = MOTOR_PCT_TO_DUTY16(CLAMP(pct, 0, 100));
+        if (t.on)
+        {
+            t.mode = MOTOR_MODE_PWM;
+        }
+        break;
+    }
+    case MOTOR_CMD_RUN:
+        t.on = cmd.value != 0;
+        t.mode = MOTOR_MODE_PWM;
+        break;
+    case MOTOR_CMD_TOGGLE:
+        t.on = !t.on;
+        t.mode = MOTOR_MODE_PWM;
+        break;
+    case MOTOR_CMD_SET:
+        t.duty16 = (uint16_t)cmd.value;
+        t.on = (cmd.value >> 16) & 1;
+        t.mode = MOTOR_MODE_PWM;
+        break;
+    case MOTOR_CMD_FREQ:
+        t.freq = cmd.value;
+        break;
+    case MOTOR_CMD_PATTERN:
+    {
+        uint8_t id = cmd.value;
+
+        if (cmd.value == MOTOR_PATTERN_NEXT)
+        {
+            // От шаблона, который будет играть к этому моменту пачки
+            id = (t.mode == MOTOR_MODE_PATTERN ? t.pattern : global_pattern) + 1;
+            if (pattern_check(id))
+            {
+                id = 0;
+            }
+        }
+        if (id == 0 && !motor_target_pattern(t))
+        {
+            break; // стоп шаблона, который не играет
+        }
+        t.pattern = id;
+        t.on = id != 0;
+        t.mode = MOTOR_MODE_PATTERN;
+        break;
+    }
+    case MOTOR_CMD_RPM:
+        if (cmd.value == 0 && !motor_target_speed(t))
+        {
+            break; // регулятор и так не работает
+        }
+        t.rpm = cmd.value;
+        t.on = cmd.value != 0;
+        t.mode = MOTOR_MODE_SPEED;
+        break;
+    case MOTOR_CMD_RAMP:
+        t.ramp = cmd.value;
+        break;
+    case MOTOR_CMD_DITHER:
+        t.dither = cmd.value != 0;
+        break;
+    case MOTOR_CMD_MULTI:
+        motor_cmd_fold_set(t, cmd.set);
+        break;
+    case MOTOR_CMD_STREAM:
+        if (cmd.value == MOTOR_STREAM_START)
+        {
+            t.mode = MOTOR_MODE_STREAM;
+        }
+        else if (cmd.value == MOTOR_STREAM_SYNC)
+        {
+            t.stream_syncs++;
+        }
+        else if (t.mode == MOTOR_MODE_KEEP || t.mode == MOTOR_MODE_STREAM)
+        {
+            // Конец потока: ШИМ снова по скважности и пуску владельца,
+            // если в пачке нет более поздней команды режима
+            t.mode = MOTOR_MODE_PWM;
+        }
+        break;
+    default:
+        break;
+    }
+
+    t.save |= (cmd.flags & MOTOR_CMD_F_SAVE) != 0;
+    t.flush |= (cmd.flags & MOTOR_CMD_F_FLUSH) != 0;
+    if (cmd.flags & MOTOR_CMD_F_BLE)
+    {
+        if (!t.ble)
+        {
+            t.ble_cyc = cmd.cyc;
+        }
+        t.ble = true;
+    }
+}
+
+static void motor_cmd_thread(void)
+{
+    motor_cmd_t cmd;
+
+    for (;;)
+    {
+        k_sem_take(&motor_cmd_sem, K_FOREVER);
+
+        motor_target_t t = {};
+        uint32_t n = 0;
+
+        t.duty16 = global_duty16;
+        t.on = global_motor_on;
+        t.ramp = global_ramp;
+        t.dither = global_dither;
+
+        while (motor_cmd_ring.pop(cmd))
+        {
+            motor_cmd_fold(t, cmd);
+            n++;
+        }
+        if (n == 0)
+        {
+            continue;
+        }
+        if (n == t.stream_syncs)
+        {
+            // Частые и ничего не меняют у владельца: без лога и события
+            motor_pwm_stream_sync();
+            continue;
+        }
+
+        global_duty16 = t.duty16;
+        global_duty_cycle = MOTOR_DUTY16_TO_PCT(t.duty16);
+        motor_set_ramp(t.ramp);
+        motor_set_dither(t.dither);
+
+        // Частота первой: она пересчитывает текущий режим под новый COUNTERTOP
+        if (t.freq && t.freq != global_pwm_freq)
+        {
+            int err = motor_set_pwm_freq(t.freq);
+
+            if (err)
+            {
+                DLOG_ERR("PWM freq %u: %d\n", t.freq, err);
+            }
+        }
+
+        if (t.mode != MOTOR_MODE_KEEP)
+        {
+            int err = 0;
+
+            // Команда владельца важнее потока уставок, он отдаёт ШИМ
+            if (t.mode != MOTOR_MODE_STREAM)
+            {
+                duty_stream_stop();
+            }
+            switch (t.mode)
+            {
+            case MOTOR_MODE_PWM:
+                global_motor_on = t.on;
+                motor_set_pwm16(t.on ? t.duty16 : 0);
+                break;
+            case MOTOR_MODE_PATTERN:
+                err = pattern_select(t.pattern);
+                break;
+            case MOTOR_MODE_SPEED:
+                err = speed_ctrl_set_rpm(t.rpm);
+                break;
+            case MOTOR_MODE_STREAM:
+                duty_stream_begin();
+                break;
+            }
+            if (err)
+            {
+                DLOG_ERR("Motor mode %u: %d\n", t.mode, err);
+            }
+
+            motor_cmd_stats.applied++;
+            if (t.ble)
+            {
+                ble_conn_param_pwm_latency(t.ble_cyc);
+            }
+        }
+        if (t.stream_syncs)
+        {
+            motor_pwm_stream_sync();
+        }
+        if (t.save)
+        {
+            nvs_save_settings();
+            if (t.flush)
+            {
+                settings_flush_async();
+            }
+        }
+
+        motor_cmd_stats.coalesced += n - 1;
+        motor_cmd_stats.batch_max = MAX(motor_cmd_stats.batch_max, n);
+        DLOG_INF("Motor %d, duty16 %u, mode %u (%u cmds)\n", global_motor_on, t.duty16, t.mode, n);
+        k_event_post(&main_events, MAIN_EV_MOTOR);
+    }
+}
+
+K_THREAD_DEFINE(motor_cmd_tid, MOTOR_CMD_STACK_SIZE, motor_cmd_thread, NULL, NULL, NULL,
+                MOTOR_CMD_PRIORITY, 0, 0);
+
+extern "C" void motor_cmd_get_stats(motor_cmd_stats_t *stats)
+{
+    *stats = motor_cmd_stats;
+}
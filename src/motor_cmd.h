@@ -0,0 +1,109 @@
+#ifndef MOTOR_CMD_H_
+#define MOTOR_CMD_H_
+
+/*
+ * Команды мотору (motor_cmd.cpp).
+ *
+ * Состояние мотора (скважность, вкл/выкл, частота, разгон, сглаживание,
+ * шаблон, регулятор скорости) меняет только поток-владелец мотора. BLE,
+ * кнопка и реестр настроек проверяют значение, кладут команду в lock-free
+ * MPSC кольцо и сразу возвращаются. Владелец забирает всё накопленное,
+ * сворачивает в одно целевое состояние и применяет его: режим работы
+ * (ШИМ, шаблон, скорость или поток уставок) - по последней команде пачки.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOTOR_CMD_QUEUE_LEN 16
+
+typedef enum
+{
+    MOTOR_CMD_DUTY16,    // value - скважность 0-65535
+    MOTOR_CMD_DUTY_STEP, // value - шаг, % (со знаком), от текущей скважности
+    MOTOR_CMD_RUN,       // value - 0 стоп, иначе пуск
+    MOTOR_CMD_TOGGLE,
+    MOTOR_CMD_SET,       // скважность и пуск одной командой, MOTOR_CMD_SET_VALUE()
+    MOTOR_CMD_SAVE,      // только сохранить настройки
+    MOTOR_CMD_FREQ,      // value - частота ШИМ, Гц (проверена pwm_freq_calc)
+    MOTOR_CMD_PATTERN,   // value - id шаблона (проверен pattern_check), 0 - стоп
+    MOTOR_CMD_RPM,       // value - уставка скорости, об/мин, 0 - стоп
+    MOTOR_CMD_RAMP,      // value - pwm_ramp_t
+    MOTOR_CMD_DITHER,    // value - 0/1
+    MOTOR_CMD_MULTI,     // несколько полей одной командой, motor_cmd_post_set()
+    MOTOR_CMD_STREAM,    // value - MOTOR_STREAM_*, поток уставок (duty_stream.h)
+} motor_cmd_type_t;
+
+#define MOTOR_PATTERN_NEXT (-1) // MOTOR_CMD_PATTERN: следующий по кругу, после последнего - стоп
+
+// MOTOR_CMD_STREAM
+#define MOTOR_STREAM_END 0   // поток закончился, вернуть ШИМ состоянию владельца
+#define MOTOR_STREAM_START 1 // отдать ШИМ потоку и запустить воспроизведение
+#define MOTOR_STREAM_SYNC 2  // пересчитать моменты выборки ADC под скважность потока
+
+#define MOTOR_CMD_SET_VALUE(duty16, run) ((int32_t)(duty16) | ((run) ? (1 << 16) : 0))
+
+#define MOTOR_CMD_F_SAVE (1u << 0)  // после применения - nvs_save_settings()
+#define MOTOR_CMD_F_BLE (1u << 1)   // учесть задержку запись BLE -> ШИМ
+#define MOTOR_CMD_F_FLUSH (1u << 2) // с MOTOR_CMD_F_SAVE: записать во flash сразу
+
+// Поля motor_set_t.mask
+#define MOTOR_SET_DUTY16 (1u << 0)
+#define MOTOR_SET_RUN (1u << 1)
+#define MOTOR_SET_FREQ (1u << 2)
+#define MOTOR_SET_RAMP (1u << 3)
+#define MOTOR_SET_DITHER (1u << 4)
+#define MOTOR_SET_PATTERN (1u << 5)
+
+/*
+ * Несколько настроек, которые владелец применяет вместе: или всё, или
+ * ничего (очередь полна). Значения проверяет вызывающий, как для
+ * одиночных команд. Порядок применения: частота, разгон, сглаживание,
+ * скважность и пуск, шаблон.
+ */
+typedef struct
+{
+    uint8_t mask;    // MOTOR_SET_*
+    uint8_t run;
+    uint8_t ramp;
+    uint8_t dither;
+    uint8_t pattern;
+    uint16_t duty16;
+    uint32_t freq;
+} motor_set_t;
+
+typedef struct
+{
+    uint32_t posted;
+    uint32_t applied;   // применений режима: ШИМ, шаблон или скорость
+    uint32_t coalesced; // команд, свёрнутых в чужое применение
+    uint32_t overflows; // кольцо было полно
+    uint32_t batch_max;
+} motor_cmd_stats_t;
+
+/**
+ * @brief Поставить команду в очередь владельца мотора
+ *
+ * Можно вызывать из потоков и ISR.
+ * @return 0, -ENOBUFS если очередь полна
+ */
+int motor_cmd_post(motor_cmd_type_t type, int32_t value, uint8_t flags);
+
+/**
+ * @brief Поставить в очередь несколько настроек одной командой
+ *
+ * Можно вызывать из потоков и ISR.
+ * @return 0, -ENOBUFS если очередь полна (не применено ничего)
+ */
+int motor_cmd_post_set(const motor_set_t *set, uint8_t flags);
+
+void motor_cmd_get_stats(motor_cmd_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTOR_CMD_H_ */
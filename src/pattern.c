@@ -0,0 +1,342 @@
+#include "define.h"
+
+/*
+ * Шаблоны скважности (вибро-эффекты): список сегментов, развёрнутый
+ * в последовательность PWM и проигрываемый EasyDMA целиком аппаратно.
+ * Запущенный шаблон не будит CPU.
+ *
+ * Шаблоны хранятся в ZMS записями PATTERN_ZMS_ID_BASE + id,
+ * если записи нет - используется встроенный шаблон с тем же id.
+ * Запись из BLE во flash идёт из системной очереди, до неё шаблон
+ * берётся из ожидающего слота в RAM.
+ */
+#define PATTERN_ZMS_ID_BASE 0x100
+#define PATTERN_MAX_ID 16
+#define PATTERN_MAX_SEGS 16
+#define PATTERN_TICK_MS 10   // длительность одного значения последовательности
+#define PATTERN_MAX_VALUES 512 // 5.12 с на один проход
+
+enum pattern_seg_type
+{
+    PATTERN_HOLD, // держать duty ms миллисекунд (duty 0 - пауза)
+    PATTERN_RAMP, // линейно от предыдущего значения до duty за ms
+};
+
+typedef struct __packed
+{
+    uint8_t type;
+    uint8_t duty; // 0-100%
+    uint16_t ms;
+} pattern_seg_t;
+
+typedef struct __packed
+{
+    uint8_t seg_count;
+    uint8_t repeat; // 0 - бесконечно
+    pattern_seg_t segs[PATTERN_MAX_SEGS];
+} pattern_t;
+
+#define PATTERN_HEADER_SIZE offsetof(pattern_t, segs)
+
+// Встроенные шаблоны, id = индекс + 1
+static const pattern_t builtin_patterns[] = {
+    // 1: серия импульсов
+    {.seg_count = 2, .repeat = 0, .segs = {
+        {PATTERN_HOLD, 80, 100},
+        {PATTERN_HOLD, 0, 100},
+    }},
+    // 2: «сердцебиение»
+    {.seg_count = 4, .repeat = 0, .segs = {
+        {PATTERN_HOLD, 70, 80},
+        {PATTERN_HOLD, 0, 120},
+        {PATTERN_HOLD, 90, 80},
+        {PATTERN_HOLD, 0, 700},
+    }},
+    // 3: плавная волна
+    {.seg_count = 3, .repeat = 0, .segs = {
+        {PATTERN_RAMP, 100, 1000},
+        {PATTERN_RAMP, 20, 1000},
+        {PATTERN_HOLD, 20, 200},
+    }},
+};
+
+// Два буфера: новый шаблон разворачивается в тот, который EasyDMA не читает
+static uint16_t pattern_seq[2][PATTERN_MAX_VALUES];
+static uint8_t pattern_seq_idx;
+
+// Ожидающий записи во flash шаблон, id 0 - слот свободен
+static struct
+{
+    pattern_t p;
+    size_t len;
+    uint8_t id;
+    uint32_t gen; // номер версии слота: перезапись во время записи во flash
+} pattern_pending;
+
+static struct k_spinlock pattern_lock;
+
+static void pattern_store_work_handler(struct k_work *work);
+static K_WORK_DEFINE(pattern_store_work, pattern_store_work_handler);
+
+static bool pattern_valid(const pattern_t *p, size_t len)
+{
+    if (len < PATTERN_HEADER_SIZE || p->seg_count == 0 || p->seg_count > PATTERN_MAX_SEGS ||
+        len < PATTERN_HEADER_SIZE + p->seg_count * sizeof(pattern_seg_t))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < p->seg_count; i++)
+    {
+        if (p->segs[i].type > PATTERN_RAMP || p->segs[i].duty > 100)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Развернуть сегменты в значения последовательности PWM
+ * @param seq Буфер PATTERN_MAX_VALUES или NULL - только посчитать длину
+ * @return количество значений, 0 если шаблон не помещается
+ */
+static uint16_t pattern_expand(const pattern_t *p, uint16_t *seq)
+{
+    uint16_t n = 0;
+    uint8_t prev = 0;
+
+    for (int i = 0; i < p->seg_count; i++)
+    {
+        const pattern_seg_t *seg = &p->segs[i];
+        uint16_t ticks = DIV_ROUND_UP(seg->ms, PATTERN_TICK_MS);
+
+        if (ticks == 0)
+        {
+            continue;
+        }
+
+        if (n + ticks > PATTERN_MAX_VALUES)
+        {
+            return 0;
+        }
+
+        for (uint16_t t = 0; t < ticks; t++)
+        {
+            uint8_t duty = seg->duty;
+
+            if (seg->type == PATTERN_RAMP)
+            {
+                duty = prev + ((int)seg->duty - prev) * (t + 1) / ticks;
+            }
+
+            if (seq)
+            {
+                seq[n] = motor_duty_to_seq(duty);
+            }
+            n++;
+        }
+
+        prev = seg->duty;
+    }
+
+    // Последовательность делится на SEQ[0]/SEQ[1], нужно минимум 2 значения
+    if (n == 1)
+    {
+        if (seq)
+        {
+            seq[1] = seq[0];
+        }
+        n++;
+    }
+
+    return n;
+}
+
+static int pattern_load(uint8_t id, pattern_t *p)
+{
+    k_spinlock_key_t key = k_spin_lock(&pattern_lock);
+    if (pattern_pending.id == id)
+    {
+        *p = pattern_pending.p;
+        k_spin_unlock(&pattern_lock, key);
+        return 0;
+    }
+    k_spin_unlock(&pattern_lock, key);
+
+    int len = zmsReadBlob(PATTERN_ZMS_ID_BASE + id, p, sizeof(*p));
+
+    if (len > 0 && pattern_valid(p, len))
+    {
+        return 0;
+    }
+
+    if (id <= ARRAY_SIZE(builtin_patterns))
+    {
+        *p = builtin_patterns[id - 1];
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+/**
+ * @brief Проверить, что шаблон можно запустить, не запуская его
+ * @param id 1..PATTERN_MAX_ID, 0 - стоп (всегда можно)
+ * @return 0 или ошибка, которую вернул бы pattern_select()
+ */
+int pattern_check(uint8_t id)
+{
+    pattern_t p;
+    int err;
+
+    if (id == 0)
+    {
+        return 0;
+    }
+
+    if (id > PATTERN_MAX_ID)
+    {
+        return -EINVAL;
+    }
+
+    err = pattern_load(id, &p);
+    if (err)
+    {
+        return err;
+    }
+
+    return pattern_expand(&p, NULL) ? 0 : -E2BIG;
+}
+
+/**
+ * @brief Запустить шаблон (только из потока-владельца мотора, motor_cmd.h)
+ * @param id 1..PATTERN_MAX_ID, 0 - остановить шаблон
+ * @return 0 при успехе, отрицательное значение при ошибке
+ */
+int pattern_select(uint8_t id)
+{
+    pattern_t p;
+    int err;
+
+    if (id == 0)
+    {
+        if (global_pattern)
+        {
+            global_motor_on = false;
+            motor_set_pwm(0);
+        }
+        return 0;
+    }
+
+    if (id > PATTERN_MAX_ID)
+    {
+        return -EINVAL;
+    }
+
+    err = pattern_load(id, &p);
+    if (err)
+    {
+        return err;
+    }
+
+    // Текущий буфер может ещё играть: разворачиваем в другой
+    uint8_t idx = pattern_seq_idx ^ 1;
+    uint16_t n = pattern_expand(&p, pattern_seq[idx]);
+    if (n == 0)
+    {
+        return -E2BIG;
+    }
+
+    err = motor_play_sequence(pattern_seq[idx], n, PATTERN_TICK_MS, p.repeat);
+    if (err)
+    {
+        return err;
+    }
+
+    pattern_seq_idx = idx;
+    global_pattern = id;
+    printk("Pattern %u: %u segs, %u values\n", id, p.seg_count, n);
+    return 0;
+}
+
+static void pattern_store_work_handler(struct k_work *work)
+{
+    pattern_t p;
+    size_t len;
+    uint8_t id;
+    uint32_t gen;
+
+    k_spinlock_key_t key = k_spin_lock(&pattern_lock);
+    p = pattern_pending.p;
+    len = pattern_pending.len;
+    id = pattern_pending.id;
+    gen = pattern_pending.gen;
+    k_spin_unlock(&pattern_lock, key);
+
+    if (id == 0)
+    {
+        return;
+    }
+
+    int err = zmsSaveBlob(PATTERN_ZMS_ID_BASE + id, &p, len);
+
+    key = k_spin_lock(&pattern_lock);
+    // Слот перезаписан во время записи - работа уже снова в очереди
+    if (pattern_pending.gen == gen)
+    {
+        pattern_pending.id = 0;
+    }
+    k_spin_unlock(&pattern_lock, key);
+
+    printk("Pattern %u stored: %d\n", id, err);
+}
+
+/**
+ * @brief Проверить шаблон и поставить его в очередь на запись в ZMS
+ *
+ * Flash пишется из системной очереди, не в вызывающем потоке (BT RX).
+ * До записи pattern_check()/pattern_select() берут шаблон из RAM.
+ * @param id 1..PATTERN_MAX_ID
+ * @param data Заголовок и сегменты в формате pattern_t
+ * @param len Длина данных
+ * @return 0 при успехе, -EBUSY если ещё пишется шаблон с другим id,
+ *         другое отрицательное значение при неверном шаблоне
+ */
+int pattern_store(uint8_t id, const void *data, size_t len)
+{
+    pattern_t p = {0};
+
+    if (id == 0 || id > PATTERN_MAX_ID || len > sizeof(p))
+    {
+        return -EINVAL;
+    }
+
+    memcpy(&p, data, len);
+    if (!pattern_valid(&p, len))
+    {
+        return -EINVAL;
+    }
+
+    // pattern_seq может сейчас играть, только проверяем длину
+    if (pattern_expand(&p, NULL) == 0)
+    {
+        return -E2BIG;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&pattern_lock);
+    if (pattern_pending.id != 0 && pattern_pending.id != id)
+    {
+        k_spin_unlock(&pattern_lock, key);
+        return -EBUSY;
+    }
+    pattern_pending.p = p;
+    pattern_pending.len = len;
+    pattern_pending.id = id;
+    pattern_pending.gen++;
+    k_spin_unlock(&pattern_lock, key);
+
+    k_work_submit(&pattern_store_work);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef PI_CTRL_H_
+#define PI_CTRL_H_
+
+/*
+ * ПИ-регулятор в фиксированной точке.
+ * Без зависимостей от Zephyr/nrfx, собирается и проверяется на хосте.
+ *
+ * Коэффициенты в Q16 (единиц выхода на единицу ошибки),
+ * интеграл хранится в единицах выхода Q8. Деления нет, только
+ * умножения 32x32->64 и сдвиги.
+ */
+
+#include <stdint.h>
+
+#define PI_GAIN_Q 16
+#define PI_INTEG_Q 8
+
+#define PI_GAIN(x) ((int32_t)((x) * (1 << PI_GAIN_Q))) // константа с плавающей точкой -> Q16
+
+typedef struct
+{
+    int32_t kp;      // Q16
+    int32_t ki;      // Q16, уже умноженный на период шага (Ki * dt)
+    int32_t out_min;
+    int32_t out_max;
+    int32_t integ;   // Q8, единицы выхода
+    int32_t out;     // последний выход
+} pi_ctrl_t;
+
+static inline int32_t pi_ctrl_clamp(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline void pi_ctrl_init(pi_ctrl_t *c, int32_t kp, int32_t ki,
+                                int32_t out_min, int32_t out_max)
+{
+    c->kp = kp;
+    c->ki = ki;
+    c->out_min = out_min;
+    c->out_max = out_max;
+    c->integ = 0;
+    c->out = out_min;
+}
+
+/**
+ * @brief Безударный старт: интеграл сразу даёт текущий выход
+ */
+static inline void pi_ctrl_reset(pi_ctrl_t *c, int32_t out)
+{
+    c->out = pi_ctrl_clamp(out, c->out_min, c->out_max);
+    c->integ = c->out * (1 << PI_INTEG_Q);
+}
+
+/**
+ * @brief Один шаг регулятора
+ *
+ * Anti-windup: при насыщении выхода интеграл не накапливается в сторону
+ * насыщения и сам ограничен диапазоном выхода.
+ */
+static inline int32_t pi_ctrl_update(pi_ctrl_t *c, int32_t setpoint, int32_t measured)
+{
+    int32_t err = setpoint - measured;
+    int32_t p = (int32_t)(((int64_t)c->kp * err) >> PI_GAIN_Q);
+    int32_t di = (int32_t)(((int64_t)c->ki * err) >> (PI_GAIN_Q - PI_INTEG_Q));
+    int32_t integ = c->integ + di;
+    int32_t out = p + (integ >> PI_INTEG_Q);
+
+    if (out > c->out_max)
+    {
+        out = c->out_max;
+        if (di > 0)
+        {
+            integ = c->integ;
+        }
+    }
+    else if (out < c->out_min)
+    {
+        out = c->out_min;
+        if (di < 0)
+        {
+            integ = c->integ;
+        }
+    }
+
+    c->integ = pi_ctrl_clamp(integ, c->out_min * (1 << PI_INTEG_Q), c->out_max * (1 << PI_INTEG_Q));
+    c->out = out;
+    return out;
+}
+
+#endif /* PI_CTRL_H_ */
@@ -0,0 +1,253 @@
+#include "define.h"
+#include "pof_snapshot.h"
+#include "settings.h"
+#include "storage.h"
+
+#include <zephyr/sys/crc.h>
+#include <nrfx_power.h>
+#include <hal/nrf_nvmc.h>
+
+/*
+ * Снимок состояния по POFWARN (питание падает ниже порога).
+ *
+ * Последняя страница раздела storage отдана под снимки (см. storage.h)
+ * и стирается заранее, при старте. Страница делится на слоты по 32 байта,
+ * снимки пишутся подряд, последний валидный - самый новый.
+ * Обработчик POFWARN не стирает и не ждёт драйвер flash: только запись
+ * POF_SNAPSHOT_WORDS слов через NVMC в готовый слот, поэтому худшее время -
+ * 8 x t_WRITE (41 мкс) плюс CRC, оно замеряется в pof_snapshot_stats_t.
+ */
+#define POF_PAGE_SIZE STORAGE_SECTOR_SIZE
+#define POF_PAGE_ADDR STORAGE_SECTOR_ADDR(STORAGE_POF_SECTOR)
+#define POF_SLOTS (POF_PAGE_SIZE / sizeof(pof_snapshot_t))
+#define POF_MIN_FREE_SLOTS 8 // меньше - страница стирается при старте
+#define POF_THRESHOLD NRF_POWER_POFTHR_V28
+
+BUILD_ASSERT(sizeof(pof_snapshot_t) == POF_SNAPSHOT_WORDS * sizeof(uint32_t),
+             "pof_snapshot_t must be exactly one slot");
+
+static const pof_snapshot_t *const pof_page = (const pof_snapshot_t *)POF_PAGE_ADDR;
+
+static pof_snapshot_t pof_base; // счётчики на момент старта, seq/pof_count - последнего снимка
+static uint16_t pof_next_slot;  // первый стёртый слот
+static bool pof_armed;
+static pof_snapshot_stats_t pof_stats;
+
+static uint32_t pof_crc(const pof_snapshot_t *s)
+{
+    return crc32_ieee((const uint8_t *)s, offsetof(pof_snapshot_t, crc));
+}
+
+// Тот же критерий при поиске последнего снимка и при проверке переноса
+static bool pof_slot_valid(const pof_snapshot_t *s)
+{
+    return s->magic == POF_SNAPSHOT_MAGIC && s->crc == pof_crc(s);
+}
+
+static bool pof_slot_erased(const pof_snapshot_t *s)
+{
+    const uint32_t *w = (const uint32_t *)s;
+
+    for (uint32_t i = 0; i < POF_SNAPSHOT_WORDS; i++)
+    {
+        if (w[i] != 0xFFFFFFFFu)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void pof_fill(pof_snapshot_t *s)
+{
+    s->magic = POF_SNAPSHOT_MAGIC;
+    s->seq = settings_generation_next();
+    s->duty16 = global_duty16;
+    s->flags = (global_motor_on ? POF_FLAG_MOTOR_ON : 0) | (global_dither ? POF_FLAG_DITHER : 0);
+    s->ramp = global_ramp;
+    s->pwm_freq = global_pwm_freq;
+    s->motor_run_s = pof_base.motor_run_s + global_motor_run_ms / 1000;
+    s->uptime_s = pof_base.uptime_s + k_uptime_get_32() / 1000;
+    s->boot_count = pof_base.boot_count;
+    s->pof_count = pof_base.pof_count + 1;
+    s->crc = pof_crc(s);
+}
+
+/**
+ * @brief Обработчик POFWARN (ISR POWER_CLOCK, вызывается через nrfx_power)
+ */
+static void pof_warn_handler(void)
+{
+    uint32_t t0 = k_cycle_get_32();
+    pof_snapshot_t s;
+
+    if (pof_next_slot >= POF_SLOTS)
+    {
+        pof_stats.skipped_full++;
+        return;
+    }
+
+    // Драйвер flash посреди стирания/записи - ждать его нельзя
+    if (!nrf_nvmc_ready_check(NRF_NVMC))
+    {
+        pof_stats.skipped_busy++;
+        return;
+    }
+
+    pof_fill(&s);
+
+    volatile uint32_t *dst = (volatile uint32_t *)&pof_page[pof_next_slot];
+    const uint32_t *src = (const uint32_t *)&s;
+    uint32_t mode = NRF_NVMC->CONFIG;
+
+    nrf_nvmc_mode_set(NRF_NVMC, NRF_NVMC_MODE_WRITE);
+    for (uint32_t i = 0; i < POF_SNAPSHOT_WORDS; i++)
+    {
+        dst[i] = src[i];
+        while (!nrf_nvmc_ready_check(NRF_NVMC))
+        {
+        }
+    }
+    NRF_NVMC->CONFIG = mode;
+
+    // Питание может вернуться: следующий снимок - в следующий слот
+    pof_next_slot++;
+    pof_base.seq = s.seq;
+    pof_base.pof_count = s.pof_count;
+
+    pof_stats.written++;
+    pof_stats.last_us = k_cyc_to_us_ceil32(k_cycle_get_32() - t0);
+    pof_stats.max_us = MAX(pof_stats.max_us, pof_stats.last_us);
+}
+
+/**
+ * @brief Найти последний снимок на странице
+ * @return true, если валидный снимок есть; счётчики запуска уже обновлены
+ */
+bool pof_snapshot_restore(pof_snapshot_t *snap)
+{
+    int last = -1;
+
+    pof_next_slot = 0;
+    for (uint32_t i = 0; i < POF_SLOTS; i++)
+    {
+        const pof_snapshot_t *s = &pof_page[i];
+
+        if (pof_slot_erased(s))
+        {
+            continue;
+        }
+        // Недописанный слот тоже занят: писать можно только в стёртый
+        pof_next_slot = i + 1;
+        if (pof_slot_valid(s))
+        {
+            last = i;
+        }
+    }
+
+    memset(&pof_base, 0, sizeof(pof_base));
+    if (last < 0)
+    {
+        pof_base.boot_count = 1;
+        return false;
+    }
+
+    pof_base = pof_page[last];
+    pof_base.boot_count++;
+    // pof_base переносится в слот 0 при стирании страницы - CRC должен сойтись
+    pof_base.crc = pof_crc(&pof_base);
+    *snap = pof_base;
+
+    printk("POF snapshot #%u: duty16 %u, motor %s, run %u s, up %u s, boots %u, pof %u\n",
+           snap->seq, snap->duty16, (snap->flags & POF_FLAG_MOTOR_ON) ? "on" : "off",
+           snap->motor_run_s, snap->uptime_s, snap->boot_count, snap->pof_count);
+    return true;
+}
+
+/**
+ * @brief Подготовить страницу снимков и включить POFWARN
+ *
+ * Если свободных слотов мало, страница стирается здесь (до BLE), а
+ * последний снимок переносится в слот 0.
+ */
+int pof_snapshot_arm(void)
+{
+    const struct device *flash = FIXED_PARTITION_DEVICE(storage);
+    int err;
+
+    if (POF_SLOTS - pof_next_slot < POF_MIN_FREE_SLOTS)
+    {
+        err = flash_erase(flash, POF_PAGE_ADDR, POF_PAGE_SIZE);
+        if (err)
+        {
+            printk("POF page erase failed: %d\n", err);
+            return err;
+        }
+        pof_next_slot = 0;
+
+        if (pof_base.magic == POF_SNAPSHOT_MAGIC)
+        {
+            err = flash_write(flash, POF_PAGE_ADDR, &pof_base, sizeof(pof_base));
+            if (err)
+            {
+                printk("POF snapshot carry-over failed: %d\n", err);
+                return err;
+            }
+            pof_next_slot = 1;
+
+            // Иначе следующий запуск не найдёт снимок и потеряет счётчики
+            if (!pof_slot_valid(&pof_page[0]))
+            {
+                printk("POF snapshot carry-over does not validate\n");
+                return -EIO;
+            }
+        }
+    }
+
+    if (!nrfx_power_init_check())
+    {
+        nrfx_power_config_t pcfg = {
+            .dcdcen = nrf_power_dcdcen_get(NRF_POWER),
+#if NRF_POWER_HAS_DCDCEN_VDDH
+            .dcdcenhv = nrf_power_dcdcen_vddh_get(NRF_POWER),
+#endif
+        };
+
+        if (nrfx_power_init(&pcfg) != NRFX_SUCCESS)
+        {
+            return -EIO;
+        }
+    }
+
+    nrfx_power_pofwarn_config_t cfg = {
+        .handler = pof_warn_handler,
+        .thr = POF_THRESHOLD,
+#if NRF_POWER_HAS_VDDH
+        .thrvddh = NRF_POWER_POFTHRVDDH_V27,
+#endif
+    };
+
+    if (nrfx_power_pof_init(&cfg) != NRFX_SUCCESS)
+    {
+        return -EIO;
+    }
+    nrfx_power_pof_enable(&cfg);
+    pof_armed = true;
+
+    printk("POFWARN armed: %u free snapshot slots\n", (unsigned)(POF_SLOTS - pof_next_slot));
+    return 0;
+}
+
+bool pof_snapshot_armed(void)
+{
+    return pof_armed;
+}
+
+void pof_snapshot_get_stats(pof_snapshot_stats_t *stats)
+{
+    unsigned int key = irq_lock();
+
+    *stats = pof_stats;
+    stats->free_slots = POF_SLOTS - pof_next_slot;
+    irq_unlock(key);
+}
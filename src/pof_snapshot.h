@@ -0,0 +1,44 @@
+#ifndef POF_SNAPSHOT_H_
+#define POF_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define POF_SNAPSHOT_MAGIC 0x53464F50u // "POFS"
+#define POF_SNAPSHOT_WORDS 8
+
+#define POF_FLAG_MOTOR_ON (1u << 0)
+#define POF_FLAG_DITHER (1u << 1)
+
+// Один слот снимка во flash, 32 байта
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;          // поколение настроек, общее с блобом (settings_generation_next)
+    uint16_t duty16;
+    uint8_t flags;         // POF_FLAG_*
+    uint8_t ramp;
+    uint32_t pwm_freq;
+    uint32_t motor_run_s;  // наработка мотора за всё время
+    uint32_t uptime_s;     // время работы устройства за всё время
+    uint16_t boot_count;
+    uint16_t pof_count;    // срабатывания POFWARN
+    uint32_t crc;          // crc32_ieee всех полей выше
+} pof_snapshot_t;
+
+typedef struct
+{
+    uint32_t written;      // снимки за этот запуск
+    uint32_t skipped_busy; // NVMC был занят (идёт стирание/запись драйвера)
+    uint32_t skipped_full; // нет подготовленного слота
+    uint32_t last_us;      // время записи снимка в ISR
+    uint32_t max_us;
+    uint16_t free_slots;
+} pof_snapshot_stats_t;
+
+bool pof_snapshot_restore(pof_snapshot_t *snap);
+int pof_snapshot_arm(void);
+bool pof_snapshot_armed(void);
+void pof_snapshot_get_stats(pof_snapshot_stats_t *stats);
+
+#endif /* POF_SNAPSHOT_H_ */
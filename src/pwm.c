@@ -1,39 +1,643 @@
 #include "define.h"
+#include "adc.h"
+#include "pwm_ramp.h"
+#include "pwm_freq.h"
+#include "speed_ctrl.h"
+#include "dlog.h"
 
-#define PWM_CHANNEL 0
-#define PWM_PERIOD_NS 1000000   // 1 kHz
+#include <soc.h>
+#include <stdlib.h>
 
-const struct device *pwm_dev;
+/*
+ * PWM0 управляется напрямую через регистры (драйвер Zephyr PWM выключен).
+ * Разгон и торможение заранее раскладываются в RAM и проигрываются
+ * последовательностью EasyDMA (SEQ[0]/SEQ[1] по очереди) без участия CPU.
+ * После конца последовательности PWM держит последнее значение.
+ *
+ * Частота ШИМ задаётся во время работы (pwm_freq.h), смена применяется
+ * в прерывании PWMPERIODEND на границе периода.
+ */
+#define PWM_HW NRF_PWM0
+#define PWM_PIN NRF_DT_GPIOS_TO_PSEL(DT_ALIAS(led0), gpios) // P0.15 "Motor PWM"
+#define PWM_DEFAULT_FREQ_HZ 1000
+#define PWM_POLARITY_HIGH 0x8000 // сначала высокий уровень, спад по COMP
+#define PWM_DITHER_LEN 32        // значений в цикле сглаживания: +5 бит разрешения
+#define PWM_ELAPSED_MAX_MS 4000  // дольше самого медленного разгона, без переполнения
+#define PWM_FREQ_TIMEOUT_MS 50   // ожидание границы периода (100 Гц = 10 мс)
+#define PWM_SYNC_UPDATE_SHIFT 5  // пересчёт моментов выборки ADC при изменении > 1/32 периода
 
-// ==================== PWM управление ====================
-void motor_set_pwm(uint8_t duty)
+// Текущие PRESCALER/COUNTERTOP
+static pwm_freq_cfg_t pwm_cfg;
+
+// Смена частоты: ждёт прерывания PWMPERIODEND
+static pwm_freq_cfg_t pwm_freq_pending;
+static uint16_t pwm_freq_hold;
+K_SEM_DEFINE(pwm_freq_sem, 0, 1);
+
+static inline uint32_t pwm_ticks_to_ns(uint32_t ticks)
+{
+    return (ticks * 125 << pwm_cfg.prescaler) / 2; // 62.5 нс * 2^prescaler
+}
+
+// Две последовательности: пока играет одна, вторая готовится
+static uint16_t pwm_seq[2][PWM_RAMP_STEPS];
+
+static struct
+{
+    uint8_t idx;       // последовательность, которая играет сейчас
+    uint8_t steps;     // значений в ней
+    uint32_t refresh;  // дополнительных периодов на значение
+    uint32_t start_ms; // момент запуска
+    uint16_t target;   // compare в конце последовательности
+} pwm_play;
+
+// Прямая запись compare регулятором скорости: одно значение, SEQ[0]
+static uint16_t pwm_direct_seq[2];
+static uint8_t pwm_direct_idx;
+static uint16_t pwm_direct_synced; // compare, о котором последний раз сообщили ADC
+
+// Поток уставок (duty_stream.cpp): буфер играет по кругу, прерывание меняет в нём compare
+static uint16_t pwm_stream_seq[2];
+static uint16_t pwm_stream_synced; // меняет только прерывание потока
+static bool pwm_stream_on;         // ШИМ отдан потоку, меняет только владелец
+
+// Сглаживание: чередование compare и compare+1 в цикле последовательности
+static uint16_t pwm_dither_seq[2][PWM_DITHER_LEN];
+static uint8_t pwm_dither_idx;
+static uint16_t pwm_dither_frac; // доля LSB для текущей цели, Q16
+static struct k_work_delayable pwm_dither_work;
+
+/**
+ * @brief Оценка текущего compare по времени от начала последовательности
+ */
+static uint16_t pwm_current_compare(void)
+{
+    if (pwm_stream_on)
+    {
+        return pwm_stream_seq[0] & ~PWM_POLARITY_HIGH;
+    }
+    if (pwm_play.steps == 0)
+    {
+        return pwm_play.target;
+    }
+
+    uint32_t elapsed_ms = k_uptime_get_32() - pwm_play.start_ms;
+
+    if (elapsed_ms > PWM_ELAPSED_MAX_MS)
+    {
+        return pwm_play.target;
+    }
+
+    uint32_t step = elapsed_ms * 1000000 / pwm_cfg.period_ns / (pwm_play.refresh + 1);
+
+    if (step >= pwm_play.steps)
+    {
+        return pwm_play.target;
+    }
+
+    return pwm_seq[pwm_play.idx][step] & ~PWM_POLARITY_HIGH;
+}
+
+/**
+ * @brief Разложить переход к target в последовательность и запустить её
+ * @param target Конечное значение compare
+ * @param stop_at_end Остановить PWM по окончании (SHORTS SEQENDn_STOP)
+ * @return длительность последовательности, мкс
+ */
+static uint32_t pwm_play_ramp(uint16_t target, bool stop_at_end)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+    const pwm_ramp_profile_t *prof = &pwm_ramp_profiles[global_ramp];
+    uint16_t from = pwm_current_compare();
+    int32_t delta = (int32_t)target - from;
+    uint8_t idx = pwm_play.idx ^ 1;
+    uint16_t *seq = pwm_seq[idx];
+    uint8_t steps = 1;
+    uint32_t refresh = 0;
+
+    if (prof->full_ms == 0 || delta == 0)
+    {
+        seq[0] = target | PWM_POLARITY_HIGH;
+    }
+    else
+    {
+        // Скорость нарастания постоянна: частичный ход короче пропорционально
+        uint32_t periods = (uint32_t)prof->full_ms * 1000000 / pwm_cfg.period_ns *
+                           (uint32_t)abs(delta) / pwm_cfg.countertop;
+
+        steps = PWM_RAMP_STEPS;
+        refresh = periods / steps;
+        refresh = refresh ? refresh - 1 : 0;
+
+        for (int i = 0; i < steps; i++)
+        {
+            seq[i] = (uint16_t)(from + delta * prof->shape[i] / (int32_t)PWM_RAMP_ONE) |
+                     PWM_POLARITY_HIGH;
+        }
+    }
+
+    pwm->SEQ[idx].PTR = (uint32_t)seq;
+    pwm->SEQ[idx].CNT = steps;
+    pwm->SEQ[idx].REFRESH = refresh;
+    pwm->SEQ[idx].ENDDELAY = 0;
+    pwm->SHORTS = stop_at_end ? (idx ? PWM_SHORTS_SEQEND1_STOP_Msk : PWM_SHORTS_SEQEND0_STOP_Msk)
+                              : 0;
+    pwm->LOOP = 0;
+    pwm->TASKS_SEQSTART[idx] = 1;
+
+    pwm_play.idx = idx;
+    pwm_play.steps = steps;
+    pwm_play.refresh = refresh;
+    pwm_play.start_ms = k_uptime_get_32();
+    pwm_play.target = target;
+
+    return (uint32_t)steps * (refresh + 1) * pwm_cfg.period_ns / 1000;
+}
+
+/**
+ * @brief Перевести скважность 0-65535 в compare без 64-битного деления
+ *
+ * x / 65535 == (x + (x >> 16) + 1) >> 16 для x < 2^32 - 2^16.
+ *
+ * @param duty16 Скважность, 65535 = 100%
+ * @param frac Остаток в долях LSB (Q16), может быть NULL
+ */
+static uint16_t pwm_duty16_to_compare(uint16_t duty16, uint16_t *frac)
+{
+    uint32_t x = (uint32_t)duty16 * pwm_cfg.countertop;
+    uint32_t q16 = x + (x >> 16) + 1;
+
+    if (frac)
+    {
+        *frac = duty16 == UINT16_MAX ? 0 : (uint16_t)q16;
+    }
+
+    return q16 >> 16;
+}
+
+static void pwm_play_loop(const uint16_t *seq, uint16_t len, uint32_t periods, uint16_t loops)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+    uint16_t half = len / 2;
+
+    pwm->SEQ[0].PTR = (uint32_t)seq;
+    pwm->SEQ[0].CNT = half;
+    pwm->SEQ[1].PTR = (uint32_t)(seq + half);
+    pwm->SEQ[1].CNT = len - half;
+
+    for (int i = 0; i < 2; i++)
+    {
+        pwm->SEQ[i].REFRESH = periods - 1;
+        pwm->SEQ[i].ENDDELAY = 0;
+    }
+
+    pwm->LOOP = loops ? loops : 1;
+    pwm->SHORTS = loops ? PWM_SHORTS_LOOPSDONE_STOP_Msk : PWM_SHORTS_LOOPSDONE_SEQSTART0_Msk;
+    pwm->TASKS_SEQSTART[0] = 1;
+}
+
+/**
+ * @brief Запустить бесконечный цикл сглаживания после окончания разгона
+ *
+ * Из PWM_DITHER_LEN значений frac * PWM_DITHER_LEN равны compare + 1,
+ * остальные compare, единицы распределены равномерно (Брезенхем).
+ */
+static void pwm_dither_start(struct k_work *work)
+{
+    uint16_t compare = pwm_play.target;
+    uint8_t idx = pwm_dither_idx ^ 1;
+    uint16_t *seq = pwm_dither_seq[idx];
+    uint32_t acc = 0;
+
+    if (!global_pwm_active || compare >= pwm_cfg.countertop)
+    {
+        return;
+    }
+
+    for (int i = 0; i < PWM_DITHER_LEN; i++)
+    {
+        acc += pwm_dither_frac;
+        seq[i] = (compare + (acc >> 16)) | PWM_POLARITY_HIGH;
+        acc &= 0xFFFF;
+    }
+
+    pwm_play_loop(seq, PWM_DITHER_LEN, 1, 0);
+    pwm_dither_idx = idx;
+
+    // target остаётся compare, следующий разгон начнётся с него
+    pwm_play.idx = 1;
+    pwm_play.steps = 0;
+}
+
+/**
+ * @brief Период фонового скана ADC по состоянию ШИМ
+ *
+ * Пока мотор крутится - быстрый скан, в простое нужна только батарея:
+ * редкий скан по RTC, TIMER2 и HFCLK не держатся.
+ */
+static void pwm_adc_scan_update(void)
+{
+    adc_stream_set_period(global_pwm_active ? ADC_SCAN_PERIOD_US : ADC_SCAN_IDLE_PERIOD_US);
+}
+
+/**
+ * @brief Значение последовательности для скважности 0-100%
+ */
+uint16_t motor_duty_to_seq(uint8_t duty)
 {
     if (duty > 100) duty = 100;
+    return pwm_duty16_to_compare(MOTOR_PCT_TO_DUTY16(duty), NULL) | PWM_POLARITY_HIGH;
+}
+
+/**
+ * @brief Проиграть готовую последовательность целиком аппаратно
+ *
+ * Буфер делится пополам между SEQ[0] и SEQ[1], LOOP повторяет пару.
+ * Бесконечный повтор - по SHORTS LOOPSDONE -> SEQSTART0, конечный
+ * заканчивается остановкой PWM по LOOPSDONE -> STOP. Прерываний нет.
+ *
+ * @param seq Значения (motor_duty_to_seq), буфер должен жить до следующей команды
+ * @param len Количество значений, не меньше 2
+ * @param step_ms Длительность одного значения, мс
+ * @param loops Количество повторов, 0 - бесконечно
+ * @return 0 при успехе, -EINVAL при неверных параметрах
+ */
+int motor_play_sequence(const uint16_t *seq, uint16_t len, uint16_t step_ms, uint16_t loops)
+{
+    uint32_t periods = step_ms <= PWM_ELAPSED_MAX_MS ? (uint32_t)step_ms * 1000000 / pwm_cfg.period_ns : 0;
+
+    if (len < 2 || periods == 0)
+    {
+        return -EINVAL;
+    }
+
+    speed_ctrl_release();
+    k_work_cancel_delayable(&pwm_dither_work);
+    pwm_play_loop(seq, len, periods, loops);
+
+    // Положение внутри шаблона не отслеживается, следующий разгон пойдёт с нуля
+    pwm_play.idx = 1;
+    pwm_play.steps = 0;
+    pwm_play.target = 0;
+
+    global_motor_on = true;
+    global_pwm_active = true;
+    pwm_adc_scan_update();
+
+    return 0;
+}
+
+static void pwm_write_cfg(const pwm_freq_cfg_t *cfg)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+
+    pwm->PRESCALER = cfg->prescaler << PWM_PRESCALER_PRESCALER_Pos;
+    pwm->COUNTERTOP = cfg->countertop;
+    pwm_cfg = *cfg;
+}
+
+/**
+ * @brief Начало нового периода: применить отложенную смену частоты
+ *
+ * Новые PRESCALER/COUNTERTOP и пересчитанное значение compare
+ * начинают действовать с ближайшей границы периода, без обрезанного импульса.
+ */
+static void pwm_isr(const void *arg)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+
+    ARG_UNUSED(arg);
+
+    if (pwm->EVENTS_PWMPERIODEND)
+    {
+        pwm->EVENTS_PWMPERIODEND = 0;
+        pwm->INTENCLR = PWM_INTENCLR_PWMPERIODEND_Msk;
+
+        pwm_write_cfg(&pwm_freq_pending);
+
+        pwm->SEQ[0].PTR = (uint32_t)&pwm_freq_hold;
+        pwm->SEQ[0].CNT = 1;
+        pwm->SEQ[0].REFRESH = 0;
+        pwm->SEQ[0].ENDDELAY = 0;
+        pwm->SHORTS = 0;
+        pwm->LOOP = 0;
+        pwm->TASKS_SEQSTART[0] = 1;
+
+        k_sem_give(&pwm_freq_sem);
+    }
+}
+
+/**
+ * @brief Сменить частоту ШИМ во время работы
+ * @param hz Частота, PWM_FREQ_MIN_HZ..PWM_FREQ_MAX_HZ
+ * @return 0 при успехе, -EINVAL если частота вне диапазона
+ */
+int motor_set_pwm_freq(uint32_t hz)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+    pwm_freq_cfg_t cfg;
+
+    if (!pwm_freq_calc(hz, &cfg))
+    {
+        return -EINVAL;
+    }
+
+    k_work_cancel_delayable(&pwm_dither_work);
+
+    if (!global_pwm_active)
+    {
+        pwm_write_cfg(&cfg);
+    }
+    else
+    {
+        // Текущее значение в новых единицах держится до повторного применения цели
+        uint16_t hold = (uint32_t)pwm_current_compare() * cfg.countertop / pwm_cfg.countertop;
+
+        pwm_freq_hold = hold | PWM_POLARITY_HIGH;
+        pwm_freq_pending = cfg;
+
+        k_sem_reset(&pwm_freq_sem);
+        pwm->EVENTS_PWMPERIODEND = 0;
+        pwm->INTENSET = PWM_INTENSET_PWMPERIODEND_Msk;
+
+        if (k_sem_take(&pwm_freq_sem, K_MSEC(PWM_FREQ_TIMEOUT_MS)))
+        {
+            // PWM успел остановиться (торможение до нуля) - границы периода нет
+            pwm->INTENCLR = PWM_INTENCLR_PWMPERIODEND_Msk;
+            pwm_write_cfg(&cfg);
+        }
+
+        pwm_play.idx = 0;
+        pwm_play.steps = 0;
+        pwm_play.target = hold;
+    }
+
+    global_pwm_freq = cfg.actual_hz;
+    printk("PWM freq: %u Hz, top %u, %u bit\n", cfg.actual_hz, cfg.countertop, cfg.bits);
+
+    // Пересчитать цель, шаблон и сглаживание под новый COUNTERTOP
+    if (pwm_stream_on)
+    {
+        // Следующий отсчёт потока придёт уже в новых единицах
+        pwm_stream_seq[0] = pwm_freq_hold;
+        pwm_stream_seq[1] = pwm_freq_hold;
+        pwm_play_loop(pwm_stream_seq, 2, 1, 0);
+        motor_pwm_stream_sync();
+    }
+    else if (global_pattern)
+    {
+        pattern_select(global_pattern);
+    }
+    else if (global_speed_rpm)
+    {
+        // Регулятор скорости сам запишет compare в новых единицах
+        pwm_direct_synced = 0;
+    }
+    else if (global_pwm_active)
+    {
+        motor_set_pwm16(global_duty16);
+    }
+    else
+    {
+        adc_sync_set_pwm(pwm_cfg.period_ns, 0);
+        pwm_direct_synced = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Настройка PWM0 через регистры
+ *
+ * Частота берётся из global_pwm_freq (загружена из ZMS до вызова).
+ * @return 0 при успехе
+ */
+int motor_pwm_init(void)
+{
+    NRF_PWM_Type *pwm = PWM_HW;
+    pwm_freq_cfg_t cfg;
+
+    if (!pwm_freq_calc(global_pwm_freq, &cfg))
+    {
+        global_pwm_freq = PWM_DEFAULT_FREQ_HZ;
+        pwm_freq_calc(global_pwm_freq, &cfg);
+    }
+
+    // Пока PWM остановлен, на выводе уровень из GPIO OUT
+    nrf_gpio_pin_clear(PWM_PIN);
+    nrf_gpio_cfg_output(PWM_PIN);
+
+    pwm->PSEL.OUT[0] = PWM_PIN;
+    pwm->MODE = PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos;
+    pwm_write_cfg(&cfg);
+    pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
+                   (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    pwm->LOOP = 0;
+    pwm->ENABLE = PWM_ENABLE_ENABLE_Enabled << PWM_ENABLE_ENABLE_Pos;
+
+    k_work_init_delayable(&pwm_dither_work, pwm_dither_start);
+
+    IRQ_CONNECT(PWM0_IRQn, 1, pwm_isr, NULL, 0);
+    irq_enable(PWM0_IRQn);
+
+    printk("PWM: %u Hz, top %u, %u bit\n", cfg.actual_hz, cfg.countertop, cfg.bits);
+
+    return 0;
+}
+
+/**
+ * @brief Выбрать профиль разгона для следующих изменений скважности
+ */
+void motor_set_ramp(uint8_t ramp)
+{
+    if (ramp < PWM_RAMP_COUNT)
+    {
+        global_ramp = ramp;
+    }
+}
+
+/**
+ * @brief Включить/выключить сглаживание дробной части скважности
+ */
+void motor_set_dither(bool enable)
+{
+    global_dither = enable;
+}
 
-    if (duty == 0 || !global_motor_on) {
-        pwm_set(pwm_dev, PWM_CHANNEL, 0, 0, 0);
+// ==================== PWM управление ====================
+/**
+ * @brief Установить скважность с разрешением 16 бит (65535 = 100%)
+ */
+void motor_set_pwm16(uint16_t duty16)
+{
+    global_pattern = 0;
+    speed_ctrl_release();
+    k_work_cancel_delayable(&pwm_dither_work);
+
+    if (duty16 == 0 || !global_motor_on) {
         if (global_pwm_active) {
-            pm_device_action_run(pwm_dev, PM_DEVICE_ACTION_SUSPEND);
+            // Торможение до нуля, PWM остановится сам по SEQEND
+            pwm_play_ramp(0, true);
             global_pwm_active = false;
-            printk("PWM suspended\n");
+            DLOG_INF("PWM suspended\n");
         }
+        adc_sync_set_pwm(pwm_cfg.period_ns, 0);
+        pwm_direct_synced = 0;
     } else {
+        uint16_t frac;
+        uint16_t compare = pwm_duty16_to_compare(duty16, &frac);
+        uint32_t pulse_ns = pwm_ticks_to_ns(compare);
+
+        uint32_t ramp_us = pwm_play_ramp(compare, false);
         if (!global_pwm_active) {
-            pm_device_action_run(pwm_dev, PM_DEVICE_ACTION_RESUME);
             global_pwm_active = true;
-            printk("PWM resumed\n");
+            DLOG_INF("PWM resumed\n");
+        }
+
+        if (global_dither && frac) {
+            pwm_dither_frac = frac;
+            k_work_schedule(&pwm_dither_work, K_USEC(ramp_us));
         }
 
-        uint32_t pulse_ns = (uint64_t)PWM_PERIOD_NS * duty / 100;
-        pwm_set(pwm_dev, PWM_CHANNEL, PWM_PERIOD_NS, pulse_ns, 0);
-        printk("Motor PWM: %d%% (%u ns)\n", duty, pulse_ns);
+        adc_sync_set_pwm(pwm_cfg.period_ns, pulse_ns);
+        pwm_direct_synced = compare;
+        DLOG_INF("Motor PWM: %u/65535 (%u ns)\n", duty16, pulse_ns);
     }
+
+    pwm_adc_scan_update();
 }
 
-void motor_toggle(void)
+/**
+ * @brief Быстрый путь регулятора скорости: compare без разгона и printk
+ *
+ * Одно значение в SEQ[0] через EasyDMA, применяется с начала следующего
+ * периода. Моменты выборки ADC пересчитываются только при заметном изменении.
+ */
+void motor_pwm_write_duty16(uint16_t duty16)
 {
-    global_motor_on = !global_motor_on;
-    printk("Motor %s at %d%%\n", global_motor_on ? "ON" : "OFF", global_duty_cycle);
-    motor_set_pwm(global_motor_on ? global_duty_cycle : 0);
-    nvs_save_settings();
-}
\ No newline at end of file
+    NRF_PWM_Type *pwm = PWM_HW;
+    uint16_t compare = pwm_duty16_to_compare(duty16, NULL);
+    uint8_t idx = pwm_direct_idx ^ 1;
+
+    if (k_work_delayable_is_pending(&pwm_dither_work))
+    {
+        k_work_cancel_delayable(&pwm_dither_work);
+    }
+    global_pattern = 0;
+
+    // Следующая запись идёт в другой буфер: DMA мог ещё не забрать текущий
+    pwm_direct_seq[idx] = compare | PWM_POLARITY_HIGH;
+    pwm->SEQ[0].PTR = (uint32_t)&pwm_direct_seq[idx];
+    pwm->SEQ[0].CNT = 1;
+    pwm->SEQ[0].REFRESH = 0;
+    pwm->SEQ[0].ENDDELAY = 0;
+    pwm->SHORTS = 0;
+    pwm->LOOP = 0;
+    pwm->TASKS_SEQSTART[0] = 1;
+    pwm_direct_idx = idx;
+
+    // Следующий разгон начнётся с этого значения
+    pwm_play.idx = 0;
+    pwm_play.steps = 0;
+    pwm_play.target = compare;
+    global_pwm_active = true;
+
+    if ((uint16_t)abs((int32_t)compare - pwm_direct_synced) > (pwm_cfg.countertop >> PWM_SYNC_UPDATE_SHIFT))
+    {
+        pwm_direct_synced = compare;
+        adc_sync_set_pwm(pwm_cfg.period_ns, pwm_ticks_to_ns(compare));
+    }
+}
+
+// ==================== Поток уставок ====================
+/**
+ * @brief Отдать ШИМ потоку уставок (только владелец мотора)
+ *
+ * Регулятор скорости, шаблон и сглаживание отпускают ШИМ. Текущее
+ * значение зацикливается в pwm_stream_seq: EasyDMA перечитывает буфер
+ * каждый период, прерывание потока меняет в нём только compare.
+ */
+void motor_pwm_stream_acquire(void)
+{
+    uint16_t compare = pwm_current_compare();
+
+    global_pattern = 0;
+    speed_ctrl_release();
+    k_work_cancel_delayable(&pwm_dither_work);
+
+    pwm_stream_seq[0] = compare | PWM_POLARITY_HIGH;
+    pwm_stream_seq[1] = compare | PWM_POLARITY_HIGH;
+    pwm_play_loop(pwm_stream_seq, 2, 1, 0);
+
+    pwm_play.idx = 1;
+    pwm_play.steps = 0;
+    pwm_play.target = compare;
+    pwm_stream_synced = compare;
+    pwm_stream_on = true;
+    global_pwm_active = true;
+
+    adc_sync_set_pwm(pwm_cfg.period_ns, pwm_ticks_to_ns(compare));
+    pwm_direct_synced = compare;
+    pwm_adc_scan_update();
+}
+
+/**
+ * @brief Забрать ШИМ у потока уставок (только владелец мотора)
+ *
+ * Буфер потока играет до следующей команды владельца, которая
+ * перепрограммирует PWM; разгон начнётся с последнего значения потока.
+ */
+void motor_pwm_stream_release(void)
+{
+    if (!pwm_stream_on)
+    {
+        return;
+    }
+
+    pwm_stream_on = false;
+    pwm_play.idx = 1;
+    pwm_play.steps = 0;
+    pwm_play.target = pwm_stream_seq[0] & ~PWM_POLARITY_HIGH;
+}
+
+/**
+ * @brief Скважность потока уставок, из прерывания TIMER4
+ *
+ * Пишет только compare в буфер, который играет по кругу: ни регистров
+ * PWM, ни состояния владельца. Пока ШИМ не отдан потоку, буфер не играет.
+ *
+ * @return true - compare заметно ушёл от моментов выборки ADC,
+ *         владельцу нужен motor_pwm_stream_sync()
+ */
+bool motor_pwm_stream_write(uint16_t duty16)
+{
+    uint16_t compare = pwm_duty16_to_compare(duty16, NULL);
+
+    pwm_stream_seq[0] = compare | PWM_POLARITY_HIGH;
+    pwm_stream_seq[1] = compare | PWM_POLARITY_HIGH;
+
+    if ((uint16_t)abs((int32_t)compare - pwm_stream_synced) > (pwm_cfg.countertop >> PWM_SYNC_UPDATE_SHIFT))
+    {
+        pwm_stream_synced = compare;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Пересчитать моменты выборки ADC под текущий compare потока (владелец)
+ */
+void motor_pwm_stream_sync(void)
+{
+    if (pwm_stream_on)
+    {
+        adc_sync_set_pwm(pwm_cfg.period_ns, pwm_ticks_to_ns(pwm_stream_seq[0] & ~PWM_POLARITY_HIGH));
+    }
+}
+
+// 8-битная обёртка: скважность 0-100%
+void motor_set_pwm(uint8_t duty)
+{
+    if (duty > 100) duty = 100;
+    motor_set_pwm16(MOTOR_PCT_TO_DUTY16(duty));
+}
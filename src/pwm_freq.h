@@ -0,0 +1,87 @@
+#ifndef PWM_FREQ_H_
+#define PWM_FREQ_H_
+
+/*
+ * Выбор PRESCALER/COUNTERTOP для частоты ШИМ.
+ * Без зависимостей от Zephyr/nrfx, проверяется на хосте
+ * (test/test_pwm_freq сверяет pwm_freq_calc() с PWM_FREQ_TABLE).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PWM_FREQ_BASE_HZ 16000000u
+#define PWM_FREQ_TOP_MAX 32767u // COUNTERTOP 15 бит
+#define PWM_FREQ_TOP_MIN 100u   // не меньше ~6.6 бит разрешения
+#define PWM_FREQ_PRESCALER_MAX 7u
+
+#define PWM_FREQ_MIN_HZ 100u
+#define PWM_FREQ_MAX_HZ (PWM_FREQ_BASE_HZ / PWM_FREQ_TOP_MIN)
+#define PWM_FREQ_ULTRASONIC_HZ 20000u // выше порога слышимости
+
+/*
+ * Опорные точки: частота, Гц | PRESCALER (делитель 2^n) | COUNTERTOP | бит.
+ * Их же отдаёт клиенту характеристика 0xABD2 как предлагаемые частоты.
+ */
+#define PWM_FREQ_TABLE(X)       \
+    X(100,   3, 20000, 14)      \
+    X(1000,  0, 16000, 13)      \
+    X(4000,  0,  4000, 11)      \
+    X(16000, 0,  1000,  9)      \
+    X(20000, 0,   800,  9)      \
+    X(25000, 0,   640,  9)      \
+    X(32000, 0,   500,  8)      \
+    X(40000, 0,   400,  8)
+
+typedef struct
+{
+    uint8_t prescaler;   // 0..7, делитель 2^prescaler
+    uint16_t countertop; // отсчётов на период
+    uint32_t actual_hz;  // реальная частота после округления
+    uint32_t period_ns;  // реальный период
+    uint8_t bits;        // эффективное разрешение скважности, бит
+} pwm_freq_cfg_t;
+
+static inline uint8_t pwm_freq_bits(uint32_t top)
+{
+    uint8_t bits = 0;
+
+    while (top >>= 1)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+/**
+ * @brief Подобрать наименьший делитель (максимальное разрешение) для частоты
+ * @return false если частота вне PWM_FREQ_MIN_HZ..PWM_FREQ_MAX_HZ
+ */
+static inline bool pwm_freq_calc(uint32_t hz, pwm_freq_cfg_t *cfg)
+{
+    if (hz < PWM_FREQ_MIN_HZ || hz > PWM_FREQ_MAX_HZ)
+    {
+        return false;
+    }
+
+    for (uint8_t p = 0; p <= PWM_FREQ_PRESCALER_MAX; p++)
+    {
+        uint32_t clk = PWM_FREQ_BASE_HZ >> p;
+        uint32_t top = (clk + hz / 2) / hz;
+
+        if (top <= PWM_FREQ_TOP_MAX)
+        {
+            cfg->prescaler = p;
+            cfg->countertop = (uint16_t)top;
+            cfg->actual_hz = clk / top;
+            // 62.5 нс * 2^p на отсчёт
+            cfg->period_ns = (uint32_t)(((uint64_t)top * 125u << p) / 2u);
+            cfg->bits = pwm_freq_bits(top);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif /* PWM_FREQ_H_ */
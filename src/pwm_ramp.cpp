@@ -0,0 +1,35 @@
+#include "pwm_ramp.h"
+
+// smoothstep 3x^2 - 2x^3, x = (i + 1) / PWM_RAMP_STEPS, результат в Q15
+static constexpr uint16_t smoothstep_q15(int i)
+{
+    uint64_t x = ((uint64_t)(i + 1) << 15) / PWM_RAMP_STEPS;
+    uint64_t x2 = (x * x) >> 15;
+    uint64_t x3 = (x2 * x) >> 15;
+    return (uint16_t)(3 * x2 - 2 * x3);
+}
+
+static constexpr pwm_ramp_profile_t make_profile(uint16_t full_ms)
+{
+    pwm_ramp_profile_t p{};
+    p.full_ms = full_ms;
+    for (int i = 0; i < PWM_RAMP_STEPS; i++)
+    {
+        p.shape[i] = full_ms ? smoothstep_q15(i) : PWM_RAMP_ONE;
+    }
+    return p;
+}
+
+static_assert(make_profile(100).shape[PWM_RAMP_STEPS - 1] == PWM_RAMP_ONE,
+              "ramp must end exactly on target");
+static_assert(make_profile(100).shape[0] < make_profile(100).shape[1],
+              "ramp must be monotonic");
+
+// Порядок совпадает с pwm_ramp_t
+extern "C" const pwm_ramp_profile_t pwm_ramp_profiles[PWM_RAMP_COUNT] = {
+    make_profile(0),    // PWM_RAMP_NONE
+    make_profile(100),  // PWM_RAMP_FAST
+    make_profile(250),  // PWM_RAMP_NORMAL
+    make_profile(500),  // PWM_RAMP_SOFT
+    make_profile(1000), // PWM_RAMP_SLOW
+};
@@ -0,0 +1,40 @@
+#ifndef PWM_RAMP_H_
+#define PWM_RAMP_H_
+
+/*
+ * Таблицы плавного разгона ШИМ, формируются на этапе компиляции (pwm_ramp.cpp).
+ * Форма - S-кривая (smoothstep) в Q15, 32768 = 1.0.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWM_RAMP_STEPS 32
+#define PWM_RAMP_ONE 32768u
+
+typedef enum
+{
+    PWM_RAMP_NONE,   // сразу на целевое значение
+    PWM_RAMP_FAST,   // 0 -> 100% за 100 мс
+    PWM_RAMP_NORMAL, // 0 -> 100% за 250 мс
+    PWM_RAMP_SOFT,   // 0 -> 100% за 500 мс
+    PWM_RAMP_SLOW,   // 0 -> 100% за 1000 мс
+    PWM_RAMP_COUNT
+} pwm_ramp_t;
+
+typedef struct
+{
+    uint16_t full_ms;                // время полного хода 0 -> 100%
+    uint16_t shape[PWM_RAMP_STEPS];  // доля хода на шаге i, Q15
+} pwm_ramp_profile_t;
+
+extern const pwm_ramp_profile_t pwm_ramp_profiles[PWM_RAMP_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PWM_RAMP_H_ */
@@ -0,0 +1,99 @@
+#ifndef PWM_SYNC_H_
+#define PWM_SYNC_H_
+
+/*
+ * Расчёт моментов выборки SAADC относительно периода ШИМ.
+ * Без зависимостей от Zephyr/nrfx, проверяется на хосте.
+ *
+ * Период начинается с включённого состояния (pulse), затем выключенное.
+ * Все величины в тиках 16 МГц (TIMER и PWM без делителя).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PWM_SYNC_CLOCK_HZ 16000000u
+
+// нс -> тики 16 МГц (до ~268 мс без переполнения)
+#define PWM_SYNC_NS_TO_TICKS(ns) ((uint32_t)(ns) * 16u / 1000u)
+#define PWM_SYNC_US_TO_TICKS(us) ((uint32_t)(us) * 16u)
+
+// COMPARE при CC=0 сразу после CLEAR не гарантирован
+#define PWM_SYNC_MIN_CC 1u
+
+typedef struct
+{
+    uint32_t period;   // период ШИМ
+    uint32_t pulse;    // длительность включённого состояния
+    uint32_t on_lead;  // от SAMPLE до начала TACQ канала тока
+    uint32_t on_acq;   // TACQ канала тока
+    uint32_t off_lead; // от SAMPLE до начала TACQ канала ЭДС
+    uint32_t off_acq;  // TACQ канала ЭДС
+    uint32_t scan;     // полное время одного скана
+    uint32_t blank;    // гашение после фронта (звон ключа)
+} pwm_sync_params_t;
+
+typedef struct
+{
+    uint32_t on_cc;  // SAMPLE во включённом состоянии, тики от начала периода
+    uint32_t off_cc; // SAMPLE в выключенном состоянии
+    bool on_valid;   // окно TACQ целиком внутри pulse за вычетом гашения
+    bool off_valid;  // то же для выключенного состояния
+    bool feasible;   // два скана помещаются в период
+} pwm_sync_timing_t;
+
+// Начало SAMPLE, при котором окно [lead, lead + acq) центрировано на mid
+static inline uint32_t pwm_sync_center(uint32_t mid, uint32_t lead, uint32_t acq)
+{
+    uint32_t shift = lead + acq / 2;
+    return mid > shift + PWM_SYNC_MIN_CC ? mid - shift : PWM_SYNC_MIN_CC;
+}
+
+static inline bool pwm_sync_inside(uint32_t cc, uint32_t lead, uint32_t acq,
+                                   uint32_t from, uint32_t to)
+{
+    return cc + lead >= from && cc + lead + acq <= to;
+}
+
+/**
+ * @brief Рассчитать моменты выборки для середины включённого и выключенного состояний
+ *
+ * Второй SAMPLE никогда не раньше окончания первого скана и всегда успевает
+ * закончиться до конца периода, поэтому раскладка DMA буфера постоянна;
+ * если окно не помещается, отсчёт помечается недостоверным.
+ */
+static inline pwm_sync_timing_t pwm_sync_calc(const pwm_sync_params_t *p)
+{
+    pwm_sync_timing_t t;
+    uint32_t pulse = p->pulse < p->period ? p->pulse : p->period;
+    uint32_t on_end = pulse > p->blank ? pulse - p->blank : 0;
+    uint32_t latest_off = p->period > p->scan + PWM_SYNC_MIN_CC ? p->period - p->scan : PWM_SYNC_MIN_CC;
+    uint32_t latest_on = latest_off > p->scan + PWM_SYNC_MIN_CC ? latest_off - p->scan : PWM_SYNC_MIN_CC;
+
+    t.feasible = p->period >= 2 * p->scan;
+
+    t.on_cc = pwm_sync_center(pulse / 2, p->on_lead, p->on_acq);
+    if (t.on_cc > latest_on)
+    {
+        t.on_cc = latest_on;
+    }
+
+    t.off_cc = pwm_sync_center(pulse + (p->period - pulse) / 2, p->off_lead, p->off_acq);
+    if (t.off_cc < t.on_cc + p->scan)
+    {
+        t.off_cc = t.on_cc + p->scan;
+    }
+    if (t.off_cc > latest_off)
+    {
+        t.off_cc = latest_off;
+    }
+
+    t.on_valid = t.feasible &&
+                 pwm_sync_inside(t.on_cc, p->on_lead, p->on_acq, p->blank, on_end);
+    t.off_valid = t.feasible &&
+                  pwm_sync_inside(t.off_cc, p->off_lead, p->off_acq, pulse + p->blank, p->period - p->blank);
+
+    return t;
+}
+
+#endif /* PWM_SYNC_H_ */
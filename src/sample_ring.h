@@ -0,0 +1,81 @@
+#ifndef SAMPLE_RING_H_
+#define SAMPLE_RING_H_
+
+/*
+ * Lock-free SPSC кольцо отсчётов int16_t.
+ * Производитель - ISR, потребитель - один поток.
+ * Не зависит от Zephyr/nrfx, собирается и на хосте.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SAMPLE_RING_LEN 64 // степень двойки
+
+#if (SAMPLE_RING_LEN & (SAMPLE_RING_LEN - 1)) != 0
+#error "SAMPLE_RING_LEN must be a power of two"
+#endif
+
+typedef struct {
+    int16_t data[SAMPLE_RING_LEN];
+    uint32_t head;     // пишет только производитель
+    uint32_t tail;     // пишет только потребитель
+    uint32_t overruns; // отсчёты, отброшенные из-за переполнения
+} sample_ring_t;
+
+static inline void sample_ring_reset(sample_ring_t *r)
+{
+    __atomic_store_n(&r->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->tail, 0, __ATOMIC_RELAXED);
+    r->overruns = 0;
+}
+
+static inline uint32_t sample_ring_count(const sample_ring_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Положить отсчёты в кольцо (сторона производителя)
+ * @return количество записанных отсчётов, остальные учтены в overruns
+ */
+static inline size_t sample_ring_put(sample_ring_t *r, const int16_t *src, size_t n)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    uint32_t space = SAMPLE_RING_LEN - (head - tail);
+    size_t put = n < space ? n : space;
+
+    for (size_t i = 0; i < put; i++)
+    {
+        r->data[(head + i) & (SAMPLE_RING_LEN - 1)] = src[i];
+    }
+
+    __atomic_store_n(&r->head, head + (uint32_t)put, __ATOMIC_RELEASE);
+    r->overruns += (uint32_t)(n - put);
+    return put;
+}
+
+/**
+ * @brief Забрать отсчёты из кольца (сторона потребителя)
+ * @return количество прочитанных отсчётов
+ */
+static inline size_t sample_ring_get(sample_ring_t *r, int16_t *dst, size_t max)
+{
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t avail = head - tail;
+    size_t got = max < avail ? max : avail;
+
+    for (size_t i = 0; i < got; i++)
+    {
+        dst[i] = r->data[(tail + i) & (SAMPLE_RING_LEN - 1)];
+    }
+
+    __atomic_store_n(&r->tail, tail + (uint32_t)got, __ATOMIC_RELEASE);
+    return got;
+}
+
+#endif /* SAMPLE_RING_H_ */
@@ -0,0 +1,233 @@
+#include "define.h"
+#include "settings.h"
+#include "pof_snapshot.h"
+
+#include <zephyr/sys/crc.h>
+
+/*
+ * Кэш настроек в RAM.
+ *
+ * nvs_save_settings() только снимает копию глобальных настроек и, если она
+ * отличается от записанной во flash, (пере)запускает отложенную запись.
+ * Запись идёт одним блобом, когда настройки не менялись
+ * SETTINGS_FLUSH_DELAY_S секунд: серия нажатий или записей BLE даёт одну
+ * запись во flash. Блоб читается один раз при старте, дальше источник -
+ * кэш и глобальные переменные.
+ *
+ * Если включён снимок по POFWARN (pof_snapshot.c), во время работы во flash
+ * не пишется ничего: настройки уходят в снимок при пропадании питания.
+ * Блоб и снимок нумеруются одним счётчиком поколений: при старте берётся
+ * более новый из них, явная запись (settings_flush) перекрывает старый снимок.
+ */
+#define NVS_ID_SETTINGS 4
+
+static settings_blob_t settings_flashed; // что лежит во flash
+static settings_blob_t settings_pending; // что ждёт записи
+static bool settings_dirty;
+static bool settings_valid;              // settings_flashed соответствует flash
+static settings_stats_t settings_stats;
+static atomic_t settings_gen; // последнее выданное поколение блоба или снимка
+
+static struct k_spinlock settings_lock;
+
+static void settings_flush_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(settings_flush_work, settings_flush_work_handler);
+
+static uint32_t settings_crc(const settings_blob_t *s)
+{
+    return crc32_ieee((const uint8_t *)s, offsetof(settings_blob_t, crc));
+}
+
+// gen и crc выставляются при записи во flash
+static void settings_capture(settings_blob_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->version = SETTINGS_VERSION;
+    s->len = settings_registry_pack(s->data, sizeof(s->data));
+}
+
+static bool settings_same(const settings_blob_t *a, const settings_blob_t *b)
+{
+    return memcmp(a, b, offsetof(settings_blob_t, gen)) == 0;
+}
+
+/**
+ * @brief Следующее поколение настроек (можно из ISR)
+ *
+ * Общий счётчик блоба и снимка POFWARN: у более поздней записи поколение
+ * больше, независимо от того, куда она легла.
+ */
+uint32_t settings_generation_next(void)
+{
+    return (uint32_t)atomic_inc(&settings_gen) + 1;
+}
+
+/**
+ * @brief Перенести снимок POFWARN в настройки через реестр
+ *
+ * Значение вне диапазона реестра отбрасывается, остаётся значение из блоба
+ * или умолчание.
+ */
+static void settings_restore_snapshot(const pof_snapshot_t *snap)
+{
+    int rejected = 0;
+
+    // Мотор после пропадания питания сам не запускается, флаг - только в журнал
+    rejected += settings_registry_set(SETTINGS_KEY_DUTY16, snap->duty16) != 0;
+    rejected += settings_registry_set(SETTINGS_KEY_PWM_FREQ, snap->pwm_freq) != 0;
+    rejected += settings_registry_set(SETTINGS_KEY_RAMP, snap->ramp) != 0;
+    rejected += settings_registry_set(SETTINGS_KEY_DITHER, (snap->flags & POF_FLAG_DITHER) != 0) != 0;
+
+    printk("Settings restored from POF snapshot #%u, rejected %d\n", snap->seq, rejected);
+}
+
+/**
+ * @brief Загрузить настройки из flash в кэш и глобальные переменные
+ *
+ * Все настройки разбираются из одного блоба за один проход. Блоб с неверной
+ * версией или CRC игнорируется, остаются умолчания реестра. Снимок POFWARN
+ * накладывается поверх, только если его поколение новее блоба.
+ */
+void nvs_load_settings(void)
+{
+    pof_snapshot_t snap;
+    bool have_snap = pof_snapshot_restore(&snap);
+    settings_blob_t s;
+    int len = zmsReadBlob(NVS_ID_SETTINGS, &s, sizeof(s));
+    bool have_blob = len == sizeof(s) && s.version == SETTINGS_VERSION && s.len <= sizeof(s.data) &&
+                     s.crc == settings_crc(&s);
+    uint32_t gen = 0;
+
+    settings_valid = false;
+
+    if (have_blob)
+    {
+        int n = settings_registry_unpack(s.data, s.len, false);
+
+        settings_flashed = s;
+        settings_valid = true;
+        gen = s.gen;
+        printk("Settings loaded: %d values, gen %u\n", n, s.gen);
+    }
+    else
+    {
+        printk("Settings blob %s, using defaults\n", len < 0 ? "missing" : "invalid");
+    }
+
+    if (have_snap && (!have_blob || snap.seq > s.gen))
+    {
+        settings_restore_snapshot(&snap);
+        // Во flash новее блоба лежит снимок: любое сохранение должно его перекрыть
+        settings_valid = false;
+        gen = snap.seq;
+    }
+
+    atomic_set(&settings_gen, gen);
+}
+
+/**
+ * @brief Отметить настройки изменёнными, запись - отложенно
+ */
+void nvs_save_settings(void)
+{
+    settings_blob_t s;
+
+    settings_capture(&s);
+
+    bool pof = pof_snapshot_armed();
+    k_spinlock_key_t key = k_spin_lock(&settings_lock);
+    bool unchanged = settings_valid && settings_same(&s, &settings_flashed);
+
+    settings_stats.requests++;
+    if (unchanged || settings_dirty || pof)
+    {
+        // Совпало с flash, влилось в ожидающую запись или уйдёт в снимок
+        settings_stats.saved_writes++;
+    }
+    settings_pending = s;
+    settings_dirty = !unchanged;
+    k_spin_unlock(&settings_lock, key);
+
+    // Со снимком по POFWARN запись во время работы не нужна
+    if (pof)
+    {
+        return;
+    }
+
+    if (unchanged)
+    {
+        // Вернулись к записанному - писать нечего
+        k_work_cancel_delayable(&settings_flush_work);
+        return;
+    }
+
+    // Перезапуск таймера: пишем только после паузы в изменениях
+    k_work_reschedule(&settings_flush_work, K_SECONDS(SETTINGS_FLUSH_DELAY_S));
+}
+
+/**
+ * @brief Записать ожидающие настройки сразу (перед сбросом, сном и т.п.)
+ */
+void settings_flush(void)
+{
+    settings_blob_t s;
+
+    k_work_cancel_delayable(&settings_flush_work);
+
+    k_spinlock_key_t key = k_spin_lock(&settings_lock);
+    if (!settings_dirty)
+    {
+        k_spin_unlock(&settings_lock, key);
+        return;
+    }
+    s = settings_pending;
+    settings_dirty = false;
+    k_spin_unlock(&settings_lock, key);
+
+    s.gen = settings_generation_next();
+    s.crc = settings_crc(&s);
+
+    int err = zmsSaveBlob(NVS_ID_SETTINGS, &s, sizeof(s));
+
+    key = k_spin_lock(&settings_lock);
+    if (err < 0)
+    {
+        settings_stats.errors++;
+        // Повторим при следующем изменении
+        if (!settings_dirty)
+        {
+            settings_pending = s;
+            settings_dirty = true;
+        }
+    }
+    else
+    {
+        settings_flashed = s;
+        settings_valid = true;
+        settings_stats.flushes++;
+    }
+    k_spin_unlock(&settings_lock, key);
+
+    printk("Settings flushed: %d, writes %u, saved %u\n",
+           err, settings_stats.flushes, settings_stats.saved_writes);
+}
+
+static void settings_flush_work_handler(struct k_work *work)
+{
+    settings_flush();
+}
+
+/**
+ * @brief Записать ожидающие настройки без паузы, но не в вызывающем потоке
+ */
+void settings_flush_async(void)
+{
+    k_work_reschedule(&settings_flush_work, K_NO_WAIT);
+}
+
+void settings_get_stats(settings_stats_t *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&settings_lock);
+    *stats = settings_stats;
+    k_spin_unlock(&settings_lock, key);
+}
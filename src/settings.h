@@ -0,0 +1,34 @@
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include <stdint.h>
+
+#include "settings_registry.h"
+
+#define SETTINGS_VERSION 3 // 2 - TLV из реестра вместо полей, 3 - поколение gen
+#define SETTINGS_FLUSH_DELAY_S 5 // запись во flash после N секунд без изменений
+
+// Образ настроек во flash: одна запись ZMS, версия и CRC32 в конце
+typedef struct __attribute__((packed))
+{
+    uint8_t version;
+    uint8_t len;                     // байт TLV в data, остаток - нули
+    uint8_t data[SETTINGS_DATA_MAX]; // settings_registry_pack()
+    uint32_t gen;                    // поколение, общее со снимком POFWARN
+    uint32_t crc;                    // crc32_ieee всех полей выше
+} settings_blob_t;
+
+typedef struct
+{
+    uint32_t requests;     // вызовы nvs_save_settings()
+    uint32_t flushes;      // фактические записи во flash
+    uint32_t saved_writes; // запросы, не потребовавшие своей записи
+    uint32_t errors;
+} settings_stats_t;
+
+void settings_flush(void);
+uint32_t settings_generation_next(void);
+void settings_flush_async(void);
+void settings_get_stats(settings_stats_t *stats);
+
+#endif /* SETTINGS_H_ */
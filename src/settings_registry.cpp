@@ -0,0 +1,281 @@
+#include "define.h"
+#include "settings_registry.h"
+#include "pwm_freq.h"
+#include "pwm_ramp.h"
+#include "motor_cmd.h"
+
+#include <zephyr/sys/byteorder.h>
+
+// Описание одной настройки, без типа: значения расширены до uint32_t
+struct setting_desc_t
+{
+    uint8_t key;
+    uint8_t size;
+    void *value;
+    uint32_t min;
+    uint32_t max;
+    uint32_t def;
+    void (*apply)(motor_set_t *set, uint32_t v); // применение при записи по BLE, nullptr - просто присвоить
+};
+
+// Типизированное объявление: переменная, границы и умолчание одного типа
+template <typename T>
+static constexpr setting_desc_t setting(uint8_t key, T &value, T min, T max, T def,
+                                        void (*apply)(motor_set_t *, uint32_t) = nullptr)
+{
+    static_assert(sizeof(T) <= sizeof(uint32_t) && T(-1) > T(0),
+                  "settings are unsigned integers up to 32 bit");
+    return {key, sizeof(T), &value, min, max, def, apply};
+}
+
+// Поля одной команды владельцу мотора (motor_cmd.h), он же сохранит настройки
+static void apply_duty16(motor_set_t *set, uint32_t v)
+{
+    set->mask |= MOTOR_SET_DUTY16;
+    set->duty16 = v;
+}
+
+static void apply_pwm_freq(motor_set_t *set, uint32_t v)
+{
+    set->mask |= MOTOR_SET_FREQ;
+    set->freq = v;
+}
+
+static void apply_ramp(motor_set_t *set, uint32_t v)
+{
+    set->mask |= MOTOR_SET_RAMP;
+    set->ramp = v;
+}
+
+static void apply_dither(motor_set_t *set, uint32_t v)
+{
+    set->mask |= MOTOR_SET_DITHER;
+    set->dither = v;
+}
+
+// Ключи - идентификаторы внутри блоба (SETTINGS_KEY_*)
+static constexpr setting_desc_t settings_registry[] = {
+    setting<uint16_t>(SETTINGS_KEY_DUTY16, global_duty16, 0, UINT16_MAX, MOTOR_PCT_TO_DUTY16(50),
+                      apply_duty16),
+    setting<uint32_t>(SETTINGS_KEY_PWM_FREQ, global_pwm_freq, PWM_FREQ_MIN_HZ, PWM_FREQ_MAX_HZ, 1000,
+                      apply_pwm_freq),
+    setting<uint8_t>(SETTINGS_KEY_RAMP, global_ramp, 0, PWM_RAMP_COUNT - 1, PWM_RAMP_NORMAL, apply_ramp),
+    setting<bool>(SETTINGS_KEY_DITHER, global_dither, false, true, false, apply_dither),
+};
+
+static constexpr bool registry_valid()
+{
+    for (const setting_desc_t &a : settings_registry)
+    {
+        if (a.min > a.max || a.def < a.min || a.def > a.max)
+        {
+            return false;
+        }
+        for (const setting_desc_t &b : settings_registry)
+        {
+            if (&a != &b && a.key == b.key)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static constexpr size_t registry_packed_size()
+{
+    size_t n = 0;
+
+    for (const setting_desc_t &s : settings_registry)
+    {
+        n += 2 + s.size;
+    }
+    return n;
+}
+
+static_assert(registry_valid(), "settings: duplicate key or default out of range");
+static_assert(sizeof(settings_registry) / sizeof(settings_registry[0]) <= 32, "settings: seen mask is 32 bit");
+static_assert(registry_packed_size() <= SETTINGS_DATA_MAX, "settings: raise SETTINGS_DATA_MAX");
+
+static const setting_desc_t *registry_find(uint8_t key)
+{
+    for (const setting_desc_t &s : settings_registry)
+    {
+        if (s.key == key)
+        {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+static uint32_t registry_get(const setting_desc_t &s)
+{
+    uint32_t v = 0;
+
+    memcpy(&v, s.value, s.size); // little-endian
+    return v;
+}
+
+static void registry_set(const setting_desc_t &s, uint32_t v)
+{
+    memcpy(s.value, &v, s.size);
+}
+
+static uint32_t registry_decode(const uint8_t *p, uint8_t size)
+{
+    uint32_t v = 0;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        v |= (uint32_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+// Производные значения, не хранятся
+static void registry_derive(void)
+{
+    global_duty_cycle = MOTOR_DUTY16_TO_PCT(global_duty16);
+}
+
+extern "C" void settings_registry_defaults(void)
+{
+    for (const setting_desc_t &s : settings_registry)
+    {
+        registry_set(s, s.def);
+    }
+    registry_derive();
+}
+
+extern "C" size_t settings_registry_pack(uint8_t *buf, size_t cap)
+{
+    size_t n = 0;
+
+    for (const setting_desc_t &s : settings_registry)
+    {
+        if (n + 2 + s.size > cap)
+        {
+            break;
+        }
+        uint32_t v = registry_get(s);
+
+        buf[n++] = s.key;
+        buf[n++] = s.size;
+        for (uint8_t i = 0; i < s.size; i++)
+        {
+            buf[n++] = v >> (8 * i);
+        }
+    }
+    return n;
+}
+
+extern "C" int settings_registry_unpack(const uint8_t *buf, size_t len, bool apply)
+{
+    int accepted = 0;
+    uint32_t seen = 0; // индексы в settings_registry
+
+    // Проход 1: проверка. При загрузке плохие записи просто пропускаются
+    for (size_t pos = 0; pos < len;)
+    {
+        if (len - pos < 2 || len - pos - 2 < buf[pos + 1])
+        {
+            return -EINVAL;
+        }
+
+        const setting_desc_t *s = registry_find(buf[pos]);
+        uint8_t size = buf[pos + 1];
+        const uint8_t *val = &buf[pos + 2];
+        pos += 2 + size;
+
+        bool ok = s && size == s->size;
+        uint32_t v = ok ? registry_decode(val, size) : 0;
+        ok = ok && v >= s->min && v <= s->max;
+
+        if (!ok)
+        {
+            if (apply)
+            {
+                return -ERANGE;
+            }
+            continue;
+        }
+
+        uint32_t bit = 1u << (s - settings_registry);
+        if (seen & bit)
+        {
+            // При загрузке действует первое значение
+            if (apply)
+            {
+                return -EEXIST;
+            }
+            continue;
+        }
+        seen |= bit;
+
+        if (!apply)
+        {
+            registry_set(*s, v);
+        }
+        accepted++;
+    }
+
+    if (!apply)
+    {
+        registry_derive();
+        return accepted;
+    }
+
+    // Проход 2 (BLE): всё проверено - одна команда владельцу мотора
+    motor_set_t set = {};
+
+    for (size_t pos = 0; pos < len; pos += 2 + buf[pos + 1])
+    {
+        const setting_desc_t *s = registry_find(buf[pos]);
+
+        if (s->apply)
+        {
+            s->apply(&set, registry_decode(&buf[pos + 2], s->size));
+        }
+    }
+
+    if (set.mask)
+    {
+        int err = motor_cmd_post_set(&set, MOTOR_CMD_F_SAVE | MOTOR_CMD_F_BLE);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    // Очередь приняла - настройки без обработчика присваиваются здесь
+    for (size_t pos = 0; pos < len; pos += 2 + buf[pos + 1])
+    {
+        const setting_desc_t *s = registry_find(buf[pos]);
+
+        if (!s->apply)
+        {
+            registry_set(*s, registry_decode(&buf[pos + 2], s->size));
+        }
+    }
+    registry_derive();
+    return accepted;
+}
+
+extern "C" int settings_registry_set(uint8_t key, uint32_t v)
+{
+    const setting_desc_t *s = registry_find(key);
+
+    if (!s)
+    {
+        return -ENOENT;
+    }
+    if (v < s->min || v > s->max)
+    {
+        return -ERANGE;
+    }
+
+    registry_set(*s, v);
+    registry_derive();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef SETTINGS_REGISTRY_H_
+#define SETTINGS_REGISTRY_H_
+
+/*
+ * Реестр настроек (settings_registry.cpp): каждая настройка объявлена один
+ * раз - тип, диапазон, значение по умолчанию, ключ. Из реестра получаются
+ * проверка значений, упаковка в блоб настроек и характеристика BLE.
+ *
+ * Упакованный вид - TLV little-endian: [ключ][длина][значение]...
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SETTINGS_DATA_MAX 48 // байт TLV всех настроек, проверяется в settings_registry.cpp
+
+// Ключи TLV, менять нельзя (1 и 3 - бывшие ID записей ZMS)
+#define SETTINGS_KEY_DUTY16 1
+#define SETTINGS_KEY_PWM_FREQ 3
+#define SETTINGS_KEY_RAMP 4
+#define SETTINGS_KEY_DITHER 5
+
+/**
+ * @brief Все настройки - значения по умолчанию
+ */
+void settings_registry_defaults(void);
+
+/**
+ * @brief Упаковать текущие значения всех настроек
+ * @return длина TLV
+ */
+size_t settings_registry_pack(uint8_t *buf, size_t cap);
+
+/**
+ * @brief Разобрать TLV за один проход
+ *
+ * apply = false (загрузка при старте): неизвестные ключи пропускаются,
+ * значения вне диапазона остаются по умолчанию, из повторов ключа
+ * действует первый.
+ * apply = true (запись BLE): сначала проверяется всё, при любой ошибке не
+ * меняется ничего; затем все значения уходят владельцу мотора одной
+ * командой (motor_cmd_post_set()) - применяются все или ни одно.
+ *
+ * @return количество принятых настроек; -EINVAL - ошибка TLV, -ERANGE -
+ *         неизвестный ключ или значение вне диапазона, -EEXIST - ключ
+ *         повторяется, -ENOBUFS - очередь команд полна
+ */
+int settings_registry_unpack(const uint8_t *buf, size_t len, bool apply);
+
+/**
+ * @brief Присвоить одну настройку с проверкой диапазона, без применения
+ *
+ * Для загрузки из источников помимо блоба (снимок POFWARN).
+ *
+ * @return 0, -ENOENT - нет такого ключа, -ERANGE - значение вне диапазона
+ */
+int settings_registry_set(uint8_t key, uint32_t v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETTINGS_REGISTRY_H_ */
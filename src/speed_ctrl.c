@@ -0,0 +1,194 @@
+#include "define.h"
+#include "adc.h"
+#include "pi_ctrl.h"
+#include "speed_ctrl.h"
+
+/*
+ * Замкнутый контур скорости: ПИ-регулятор в отдельном потоке с фиксированным
+ * периодом. Обратная связь - ЭДС мотора, измеренная SAADC в середине паузы ШИМ
+ * (adc_sync_start с bemf). Выход пишется прямо в compare PWM0, без разгона.
+ *
+ * Поток кооперативный: вызовы из BLE и system workqueue не прерывают шаг
+ * посередине, speed_ctrl_release() вступает в силу до следующего шага.
+ */
+#define SPEED_CTRL_PERIOD_US 10000
+#define SPEED_CTRL_STACK_SIZE 1024
+#define SPEED_CTRL_PRIORITY -2 // выше system workqueue
+
+// Отсчёт ЭДС -> об/мин: 12 бит на 3.6 В (Gain1_6), делитель на входе, Kv мотора
+#define SPEED_BEMF_DIVIDER 4
+#define SPEED_MOTOR_KV 3000 // об/мин на вольт
+#define SPEED_RPM_PER_LSB_Q8 (3600 * SPEED_BEMF_DIVIDER * SPEED_MOTOR_KV / 1000 * 256 / 4096)
+
+// Выход ограничен, чтобы в периоде оставалась пауза для выборки ЭДС
+#define SPEED_DUTY16_MAX MOTOR_PCT_TO_DUTY16(95)
+#define SPEED_KP PI_GAIN(2.0)                                   // duty16 на об/мин
+#define SPEED_KI PI_GAIN(20.0 * SPEED_CTRL_PERIOD_US / 1000000) // duty16 на об/мин*с, за шаг
+
+static pi_ctrl_t speed_pi;
+static int32_t speed_measured_rpm;
+static speed_ctrl_stats_t speed_stats;
+
+K_SEM_DEFINE(speed_ctrl_sem, 0, 1);
+
+static void speed_ctrl_step(void)
+{
+    const adc_sync_frame_t *frame = adc_sync_frame();
+
+    if (frame->bemf_valid && frame->count)
+    {
+        int32_t sum = 0;
+
+        for (int i = 0; i < frame->count; i++)
+        {
+            sum += MAX(frame->bemf[i], 0);
+        }
+
+        speed_measured_rpm = (sum / frame->count * SPEED_RPM_PER_LSB_Q8) >> 8;
+    }
+    else
+    {
+        speed_stats.no_feedback++;
+    }
+
+    motor_pwm_write_duty16(pi_ctrl_update(&speed_pi, global_speed_rpm, speed_measured_rpm));
+}
+
+static void speed_ctrl_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    const int64_t period = k_us_to_ticks_ceil64(SPEED_CTRL_PERIOD_US);
+
+    while (1)
+    {
+        k_sem_take(&speed_ctrl_sem, K_FOREVER);
+
+        int64_t deadline = k_uptime_ticks();
+
+        while (global_speed_rpm)
+        {
+            deadline += period;
+            k_sleep(K_TIMEOUT_ABS_TICKS(deadline));
+
+            if (!global_speed_rpm)
+            {
+                break;
+            }
+
+            uint32_t start = k_cycle_get_32();
+            int64_t now = k_uptime_ticks();
+            int64_t late = now - deadline;
+
+            speed_ctrl_step();
+
+            uint32_t exec = k_cycle_get_32() - start;
+
+            speed_stats.iterations++;
+            speed_stats.jitter_last_us = k_ticks_to_us_floor32(late);
+            speed_stats.jitter_max_us = MAX(speed_stats.jitter_max_us, speed_stats.jitter_last_us);
+            speed_stats.exec_last_cyc = exec;
+            speed_stats.exec_max_cyc = MAX(speed_stats.exec_max_cyc, exec);
+
+            // Пропущенные шаги не догоняются
+            if (late >= period)
+            {
+                speed_stats.overruns++;
+                deadline = now;
+            }
+        }
+    }
+}
+
+K_THREAD_DEFINE(speed_ctrl_tid, SPEED_CTRL_STACK_SIZE, speed_ctrl_thread, NULL, NULL, NULL,
+                SPEED_CTRL_PRIORITY, 0, 0);
+
+/**
+ * @brief Задать скорость в замкнутом контуре
+ *
+ * Первый ненулевой вызов переводит ADC в выборку по периоду ШИМ с ЭДС
+ * и будит поток регулятора. Любая команда скважности (motor_set_pwm16,
+ * шаблон) возвращает разомкнутый режим.
+ *
+ * @param rpm Скорость, об/мин; 0 - выключить мотор
+ * @return 0 при успехе, отрицательное значение при ошибке
+ */
+int speed_ctrl_set_rpm(uint16_t rpm)
+{
+    int err;
+
+    if (rpm > SPEED_RPM_MAX)
+    {
+        return -EINVAL;
+    }
+
+    if (rpm == 0)
+    {
+        if (global_speed_rpm)
+        {
+            global_motor_on = false;
+            motor_set_pwm16(0);
+        }
+        return 0;
+    }
+
+    if (global_speed_rpm)
+    {
+        global_speed_rpm = rpm;
+        return 0;
+    }
+
+    adc_stream_stop();
+    err = adc_sync_start(true, NULL);
+    if (err)
+    {
+        adc_stream_start(ADC_SCAN_PERIOD_US, NULL);
+        return err;
+    }
+
+    // Безударный переход: интеграл продолжает текущую скважность
+    pi_ctrl_init(&speed_pi, SPEED_KP, SPEED_KI, 0, SPEED_DUTY16_MAX);
+    pi_ctrl_reset(&speed_pi, global_pwm_active ? global_duty16 : 0);
+    speed_measured_rpm = 0;
+    memset(&speed_stats, 0, sizeof(speed_stats));
+
+    global_motor_on = true;
+    global_speed_rpm = rpm;
+    k_sem_give(&speed_ctrl_sem);
+
+    printk("Speed control: %u rpm\n", rpm);
+    return 0;
+}
+
+/**
+ * @brief Выйти из замкнутого контура, не трогая PWM
+ *
+ * Вызывается перед любой командой скважности, ADC возвращается в скан.
+ */
+void speed_ctrl_release(void)
+{
+    if (!global_speed_rpm)
+    {
+        return;
+    }
+
+    global_speed_rpm = 0;
+    adc_sync_stop();
+    adc_stream_start(ADC_SCAN_PERIOD_US, NULL);
+
+    printk("Speed control off: %u steps, jitter max %u us, exec max %u us, overruns %u\n",
+           speed_stats.iterations, speed_stats.jitter_max_us,
+           k_cyc_to_us_floor32(speed_stats.exec_max_cyc), speed_stats.overruns);
+}
+
+uint16_t speed_ctrl_measured_rpm(void)
+{
+    return (uint16_t)MIN(speed_measured_rpm, UINT16_MAX);
+}
+
+void speed_ctrl_get_stats(speed_ctrl_stats_t *stats)
+{
+    *stats = speed_stats;
+}
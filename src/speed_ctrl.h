@@ -0,0 +1,24 @@
+#ifndef SPEED_CTRL_H_
+#define SPEED_CTRL_H_
+
+#include <stdint.h>
+
+#define SPEED_RPM_MAX 20000
+
+typedef struct
+{
+    uint32_t iterations;
+    uint32_t overruns;       // шаг опоздал больше чем на период
+    uint32_t no_feedback;    // кадра с ЭДС не было, держится прошлое измерение
+    uint32_t jitter_last_us; // опоздание пробуждения относительно расписания
+    uint32_t jitter_max_us;
+    uint32_t exec_last_cyc;  // время шага регулятора, такты CPU
+    uint32_t exec_max_cyc;
+} speed_ctrl_stats_t;
+
+int speed_ctrl_set_rpm(uint16_t rpm);
+void speed_ctrl_release(void);
+uint16_t speed_ctrl_measured_rpm(void);
+void speed_ctrl_get_stats(speed_ctrl_stats_t *stats);
+
+#endif /* SPEED_CTRL_H_ */
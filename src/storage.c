@@ -1,3 +1,5 @@
+#include "define.h"
+#include "storage.h"
 
 #include <zephyr/drivers/flash.h>
 #include <zephyr/storage/flash_map.h>
@@ -10,13 +12,29 @@
 #define NVS_PARTITION_DEVICE FIXED_PARTITION_DEVICE(NVS_PARTITION)
 #define NVS_PARTITION_OFFSET FIXED_PARTITION_OFFSET(NVS_PARTITION)
 
-#define ZMS_NUM_SECTORS 8
+#define ZMS_NUM_SECTORS STORAGE_ZMS_SECTORS // остальное место раздела - телеметрия и снимок POFWARN
+
+/*
+ * Обслуживание ZMS в простое.
+ *
+ * Когда в активном секторе кончается место, очередной zms_write() сам
+ * запускает сборку мусора и стирание страницы 4 КБ (~85 мс) в потоке,
+ * который писал, - например, в потоке BT RX. Поток обслуживания следит за
+ * свободным местом и, пока мотор стоит, заранее переключает ZMS на
+ * следующий сектор (zms_sector_use_next: GC + стирание), так что запись
+ * на переднем плане всегда попадает в подготовленный сектор.
+ */
+#define STORAGE_GC_RESERVE 512        // байт в активном секторе, меньше - пора готовить следующий
+#define STORAGE_MAINT_RETRY_MS 1000   // повтор, пока GC отложен из-за работы мотора
+#define STORAGE_MAINT_STACK_SIZE 1024
+#define STORAGE_MAINT_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO - 1)
 
 struct zms_fs zms;
 
-extern uint8_t duty_cycle;
-extern bool motor_on;
-extern bool pwm_active;
+static bool zms_ready;
+static storage_stats_t storage_stats;
+static struct k_spinlock storage_lock;
+K_SEM_DEFINE(storage_maint_sem, 0, 1);
 
 // ==================== NVS функции ====================
 /**
@@ -50,7 +68,7 @@ int nvs_init_storage(void)
     zms.sector_size = info.size;
 
     // Используем 3-4 сектора для NVS (из доступных 8)
-    zms.sector_count = ZMS_NUM_SECTORS; // 8 * 4KB = 32 KB для NVS
+    zms.sector_count = ZMS_NUM_SECTORS; // 3 * 4KB = 12 KB для NVS
 
     printk("Zms init:\n");
     printk("  Flash device: %s\n", zms.flash_device->name);
@@ -67,93 +85,171 @@ int nvs_init_storage(void)
         return err;
     }
 
-    printk("  Free space: %d bytes\n", zms_calc_free_space(&zms));
+    storage_stats.free_bytes = zms_calc_free_space(&zms);
+    printk("  Free space: %d bytes\n", storage_stats.free_bytes);
     printk("NVS mounted successfully\n");
+
+    zms_ready = true;
+    k_sem_give(&storage_maint_sem);
     return 0;
 }
 
-/**
- * @brief Сохранить байт данных в ZMS
- * @param id Идентификатор записи
- * @param data Данные для сохранения
- * @return 0 при успехе, отрицательное значение при ошибке
- */
-int zmsSave(uint32_t id, uint8_t data)
+static void storage_hist_add(storage_hist_t *h, uint32_t us)
 {
-    int err = zms_write(&zms, id, &data, 1);
+    uint32_t b = 0;
 
-    if (err < 0)
+    if (us >= STORAGE_HIST_BASE_US)
     {
-        printk("ZMS write error (id: %lu): %d - ", (unsigned long)id, err);
-
-        switch (err)
-        {
-        case -EACCES:
-            printk("not initialized\n");
-            break;
-        case -ENXIO:
-            printk("device error\n");
-            break;
-        case -EIO:
-            printk("read/write error\n");
-            break;
-        case -EINVAL:
-            printk("invalid length\n");
-            break;
-        case -ENOSPC:
-            printk("no space left\n");
-            break;
-        default:
-            printk("unknown error\n");
-            break;
-        }
+        b = 32 - __builtin_clz(us / STORAGE_HIST_BASE_US);
+        b = MIN(b, STORAGE_HIST_BUCKETS - 1);
     }
 
-    return err;
+    k_spinlock_key_t key = k_spin_lock(&storage_lock);
+    h->count++;
+    h->bucket[b]++;
+    h->max_us = MAX(h->max_us, us);
+    k_spin_unlock(&storage_lock, key);
 }
 
 /**
- * @brief Прочитать байт данных из ZMS
- * @param id Идентификатор записи
- * @param data Указатель для сохранения прочитанных данных
- * @param default_value Значение по умолчанию, если запись не найдена
- * @return 0 при успехе, отрицательное значение при ошибке
+ * @brief zms_write() с замером задержки, после записи будит обслуживание
  */
-int zmsRead(uint32_t id, uint8_t *data, uint8_t default_value)
+static ssize_t zmsWriteTimed(uint32_t id, const void *data, size_t len)
 {
+    uint32_t t0 = k_cycle_get_32();
+    ssize_t ret = zms_write(&zms, id, data, len);
+
+    storage_hist_add(&storage_stats.write, k_cyc_to_us_floor32(k_cycle_get_32() - t0));
+    k_sem_give(&storage_maint_sem);
+    return ret;
+}
 
-    if (data == NULL)
+void storage_get_stats(storage_stats_t *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&storage_lock);
+    *stats = storage_stats;
+    k_spin_unlock(&storage_lock, key);
+}
+
+static void storage_print_hist(const char *name, const storage_hist_t *h)
+{
+    printk("ZMS %s: n %u, max %u us |", name, h->count, h->max_us);
+    for (uint32_t i = 0; i < STORAGE_HIST_BUCKETS; i++)
     {
-        printk("ZMS read error: null pointer\n");
-        return -EINVAL;
+        printk(" %u", h->bucket[i]);
     }
+    printk("\n");
+}
+
+static void storage_maint_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    // Без отложенного GC поток спит до следующей записи
+    k_timeout_t wait = K_FOREVER;
 
-    int err = zms_read(&zms, id, data, 1);
-    if (err == 1)
+    while (1)
     {
-        printk("ZMS read (id: %lu): %u\n", (unsigned long)id, *data);
-        return 0;
+        k_sem_take(&storage_maint_sem, wait);
+        wait = K_FOREVER;
+
+        if (!zms_ready)
+        {
+            continue;
+        }
+
+        ssize_t active_free = zms_active_sector_free_space(&zms);
+        if (active_free < 0 || active_free >= STORAGE_GC_RESERVE)
+        {
+            continue;
+        }
+
+        // Стирание - десятки мс занятой flash, делаем только пока мотор стоит
+        if (global_pwm_active)
+        {
+            storage_stats.gc_deferred++;
+            wait = K_MSEC(STORAGE_MAINT_RETRY_MS);
+            continue;
+        }
+
+        uint32_t t0 = k_cycle_get_32();
+        int err = zms_sector_use_next(&zms);
+        uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - t0);
+
+        if (err)
+        {
+            printk("ZMS GC error: %d\n", err);
+            continue;
+        }
+
+        storage_hist_add(&storage_stats.gc, us);
+        storage_stats.free_bytes = zms_calc_free_space(&zms);
+
+        printk("ZMS GC in idle: %u us, free %d bytes\n", us, storage_stats.free_bytes);
+        storage_print_hist("write", &storage_stats.write);
+        storage_print_hist("gc", &storage_stats.gc);
     }
+}
+
+K_THREAD_DEFINE(storage_maint_tid, STORAGE_MAINT_STACK_SIZE, storage_maint_thread, NULL, NULL, NULL,
+                STORAGE_MAINT_PRIORITY, 0, 0);
 
-    // Обработка ошибок
-    printk("ZMS read error (id: %lu): %d - ", (unsigned long)id, err);
+static void zmsPrintError(uint32_t id, int err)
+{
+    printk("ZMS write error (id: %lu): %d - ", (unsigned long)id, err);
 
     switch (err)
     {
     case -EACCES:
         printk("not initialized\n");
         break;
+    case -ENXIO:
+        printk("device error\n");
+        break;
     case -EIO:
         printk("read/write error\n");
         break;
-    case -ENOENT:
-        printk("entry not found, using default: %u\n", default_value);
+    case -EINVAL:
+        printk("invalid length\n");
+        break;
+    case -ENOSPC:
+        printk("no space left\n");
         break;
     default:
         printk("unknown error\n");
         break;
     }
+}
+
+/**
+ * @brief Сохранить запись произвольной длины в ZMS
+ * @param id Идентификатор записи
+ * @param data Данные для сохранения
+ * @param len Длина данных
+ * @return количество записанных байт, отрицательное значение при ошибке
+ */
+int zmsSaveBlob(uint32_t id, const void *data, size_t len)
+{
+    int err = zmsWriteTimed(id, data, len);
+
+    if (err < 0)
+    {
+        zmsPrintError(id, err);
+    }
 
-    *data = default_value;
     return err;
 }
+
+/**
+ * @brief Прочитать запись произвольной длины из ZMS
+ * @param id Идентификатор записи
+ * @param data Буфер для данных
+ * @param len Размер буфера
+ * @return количество прочитанных байт, -ENOENT если записи нет
+ */
+int zmsReadBlob(uint32_t id, void *data, size_t len)
+{
+    return zms_read(&zms, id, data, len);
+}
@@ -0,0 +1,37 @@
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+#include <stdint.h>
+
+// Раздел storage (32 КБ, 8 секторов по 4 КБ):
+//   0..2 - ZMS (настройки, шаблоны), 3..6 - журнал телеметрии, 7 - снимок POFWARN
+#define STORAGE_SECTOR_SIZE 4096
+#define STORAGE_ZMS_SECTORS 3
+#define STORAGE_TELEM_SECTOR 3
+#define STORAGE_TELEM_SECTORS 4
+#define STORAGE_POF_SECTOR 7
+#define STORAGE_SECTOR_ADDR(n) (FIXED_PARTITION_OFFSET(storage) + (n) * STORAGE_SECTOR_SIZE)
+
+// Гистограмма задержек записи: корзина 0 - < 16 мкс, корзина k -
+// [16 << (k - 1), 16 << k) мкс, последняя - всё, что дольше
+#define STORAGE_HIST_BUCKETS 14
+#define STORAGE_HIST_BASE_US 16
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t bucket[STORAGE_HIST_BUCKETS];
+} storage_hist_t;
+
+typedef struct
+{
+    storage_hist_t write; // zms_write() из zmsSaveBlob
+    storage_hist_t gc;    // сборка мусора + стирание в простое
+    uint32_t gc_deferred; // проверки, когда GC был нужен, но мотор работал
+    int32_t free_bytes;   // zms_calc_free_space() на последней проверке
+} storage_stats_t;
+
+void storage_get_stats(storage_stats_t *stats);
+
+#endif /* STORAGE_H_ */
@@ -0,0 +1,383 @@
+#include "define.h"
+#include "telemetry.h"
+#include "storage.h"
+#include "adc.h"
+#include "dlog.h"
+#include "speed_ctrl.h"
+
+#include <zephyr/sys/crc.h>
+
+/*
+ * Кольцо блоков телеметрии в секторах STORAGE_TELEM_SECTOR.. раздела storage.
+ *
+ * Запись копится в RAM-блоке (добавление - O(1), без flash), полный блок
+ * уходит в очередь, поток телеметрии пишет его во flash. Стирание сектора
+ * под новый блок - только пока мотор стоит, до этого блоки ждут в очереди.
+ * При старте кольцо восстанавливается по самому большому seq.
+ *
+ * Чтение (BLE): непрерывный поток блоков от старых к новым - flash, очередь,
+ * текущий недописанный блок.
+ */
+#define TELEM_ADDR STORAGE_SECTOR_ADDR(STORAGE_TELEM_SECTOR)
+#define TELEM_BLOCKS_PER_SECTOR (STORAGE_SECTOR_SIZE / TELEM_BLOCK_SIZE)
+#define TELEM_BLOCKS (STORAGE_TELEM_SECTORS * TELEM_BLOCKS_PER_SECTOR)
+#define TELEM_QUEUE_LEN 2
+#define TELEM_REC_MAX 16 // 4 varint, худший случай
+#define TELEM_STACK_SIZE 1024
+#define TELEM_PRIORITY (K_LOWEST_APPLICATION_THREAD_PRIO - 1)
+#define TELEM_START_DELAY_MS 1000 // после монтирования ZMS в main()
+
+BUILD_ASSERT(STORAGE_SECTOR_SIZE % TELEM_BLOCK_SIZE == 0, "block must divide sector");
+BUILD_ASSERT(TELEM_PAYLOAD_MAX <= UINT8_MAX, "len field is 8 bit");
+
+typedef union
+{
+    telem_block_hdr_t hdr;
+    uint8_t raw[TELEM_BLOCK_SIZE];
+} telem_block_t;
+
+static const telem_block_t *const telem_flash = (const telem_block_t *)TELEM_ADDR;
+
+static struct
+{
+    uint16_t head;  // следующий блок во flash
+    uint16_t count; // блоков с данными перед head
+    uint32_t seq;   // seq следующего блока
+} telem_ring;
+
+static telem_block_t telem_cur;
+static telem_block_t telem_queue[TELEM_QUEUE_LEN];
+static uint8_t telem_queue_head;
+static uint8_t telem_queue_count;
+
+// Предыдущая запись, для разностей
+static uint16_t telem_prev_vbat;
+static uint8_t telem_prev_duty;
+static bool telem_boot = true;
+
+static telemetry_stats_t telem_stats;
+
+K_MUTEX_DEFINE(telem_mutex);
+
+static uint8_t *telem_put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint32_t telem_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static bool telem_block_valid(const telem_block_t *b)
+{
+    return b->hdr.magic == TELEM_BLOCK_MAGIC && b->hdr.len <= TELEM_PAYLOAD_MAX &&
+           b->hdr.crc == crc16_ccitt(0, b->raw + sizeof(telem_block_hdr_t), b->hdr.len);
+}
+
+/**
+ * @brief Восстановить положение кольца по блокам во flash
+ */
+static void telem_scan(void)
+{
+    int newest = -1;
+    uint32_t max_seq = 0;
+
+    for (int i = 0; i < TELEM_BLOCKS; i++)
+    {
+        if (telem_block_valid(&telem_flash[i]) && (newest < 0 || telem_flash[i].hdr.seq > max_seq))
+        {
+            newest = i;
+            max_seq = telem_flash[i].hdr.seq;
+        }
+    }
+
+    telem_ring.head = 0;
+    telem_ring.count = 0;
+    telem_ring.seq = 0;
+    if (newest < 0)
+    {
+        return;
+    }
+
+    // Данные - непрерывная цепочка seq, идущая назад от самого нового блока
+    telem_ring.head = (newest + 1) % TELEM_BLOCKS;
+    telem_ring.seq = max_seq + 1;
+    for (int k = 0; k < TELEM_BLOCKS; k++)
+    {
+        const telem_block_t *b = &telem_flash[(newest - k + TELEM_BLOCKS) % TELEM_BLOCKS];
+
+        if (!telem_block_valid(b) || b->hdr.seq != max_seq - k)
+        {
+            break;
+        }
+        telem_ring.count++;
+    }
+
+    printk("Telemetry: %u blocks, next seq %u\n", telem_ring.count, telem_ring.seq);
+}
+
+static void telem_block_start(uint16_t vbat, uint8_t duty)
+{
+    memset(&telem_cur, 0, sizeof(telem_cur));
+    telem_cur.hdr.magic = TELEM_BLOCK_MAGIC;
+    telem_cur.hdr.seq = telem_ring.seq; // окончательно - при закрытии блока
+    telem_cur.hdr.t0_s = k_uptime_get_32() / 1000;
+    telem_cur.hdr.period_s = TELEM_PERIOD_S;
+    telem_cur.hdr.vbat_mv = vbat;
+    telem_cur.hdr.duty = duty;
+    telem_cur.hdr.flags = telem_boot ? TELEM_BLK_BOOT : 0;
+    telem_boot = false;
+    telem_prev_vbat = vbat;
+    telem_prev_duty = duty;
+}
+
+// Вызывать под telem_mutex
+static void telem_block_seal(void)
+{
+    if (telem_queue_count == TELEM_QUEUE_LEN)
+    {
+        // Мотор не давал стереть сектор: теряем самый новый блок, старые в очереди
+        telem_stats.dropped += telem_cur.hdr.count;
+        telem_cur.hdr.count = 0;
+        return;
+    }
+
+    telem_cur.hdr.seq = telem_ring.seq++;
+    telem_queue[(telem_queue_head + telem_queue_count) % TELEM_QUEUE_LEN] = telem_cur;
+    telem_queue_count++;
+    telem_cur.hdr.count = 0;
+}
+
+/**
+ * @brief Добавить запись в текущий блок, O(1), без обращения к flash
+ */
+static void telem_append(uint16_t vbat, uint8_t duty, uint32_t run_s, uint32_t faults)
+{
+    uint8_t rec[TELEM_REC_MAX];
+    uint8_t *p;
+
+    k_mutex_lock(&telem_mutex, K_FOREVER);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (telem_cur.hdr.count == 0)
+        {
+            telem_block_start(vbat, duty);
+        }
+
+        p = telem_put_varint(rec, telem_zigzag((int32_t)vbat - telem_prev_vbat));
+        p = telem_put_varint(p, telem_zigzag((int32_t)duty - telem_prev_duty));
+        p = telem_put_varint(p, run_s);
+        p = telem_put_varint(p, faults);
+
+        if (telem_cur.hdr.len + (p - rec) <= TELEM_PAYLOAD_MAX && telem_cur.hdr.count < UINT8_MAX)
+        {
+            break;
+        }
+        // Не влезло - блок закрывается, запись начинает новый с нулевыми разностями
+        telem_block_seal();
+    }
+
+    memcpy(telem_cur.raw + sizeof(telem_block_hdr_t) + telem_cur.hdr.len, rec, p - rec);
+    telem_cur.hdr.len += p - rec;
+    telem_cur.hdr.count++;
+    telem_cur.hdr.crc = crc16_ccitt(0, telem_cur.raw + sizeof(telem_block_hdr_t), telem_cur.hdr.len);
+    telem_prev_vbat = vbat;
+    telem_prev_duty = duty;
+    telem_stats.samples++;
+
+    k_mutex_unlock(&telem_mutex);
+}
+
+/**
+ * @brief Записать блоки из очереди во flash
+ */
+static void telem_flush(void)
+{
+    const struct device *flash = FIXED_PARTITION_DEVICE(storage);
+
+    k_mutex_lock(&telem_mutex, K_FOREVER);
+
+    while (telem_queue_count)
+    {
+        off_t addr = TELEM_ADDR + telem_ring.head * TELEM_BLOCK_SIZE;
+        int err;
+
+        if (telem_ring.head % TELEM_BLOCKS_PER_SECTOR == 0)
+        {
+            // Стирание - десятки мс занятой flash, только пока мотор стоит
+            if (global_pwm_active)
+            {
+                telem_stats.erase_deferred++;
+                break;
+            }
+
+            err = flash_erase(flash, addr, STORAGE_SECTOR_SIZE);
+            if (err)
+            {
+                printk("Telemetry erase failed: %d\n", err);
+                break;
+            }
+            telem_ring.count = MIN(telem_ring.count, TELEM_BLOCKS - TELEM_BLOCKS_PER_SECTOR);
+        }
+
+        err = flash_write(flash, addr, &telem_queue[telem_queue_head], TELEM_BLOCK_SIZE);
+        if (err)
+        {
+            printk("Telemetry write failed: %d\n", err);
+            break;
+        }
+
+        telem_ring.head = (telem_ring.head + 1) % TELEM_BLOCKS;
+        telem_ring.count = MIN(telem_ring.count + 1, TELEM_BLOCKS);
+        telem_queue_head = (telem_queue_head + 1) % TELEM_QUEUE_LEN;
+        telem_queue_count--;
+        telem_stats.blocks_written++;
+    }
+
+    k_mutex_unlock(&telem_mutex);
+}
+
+static void telemetry_thread(void *p1, void *p2, void *p3)
+{
+    uint32_t adc_overruns = adc_stream_overruns();
+    uint32_t log_dropped = dlog_dropped();
+    uint32_t run_mark_ms = global_motor_run_ms;
+    speed_ctrl_stats_t sc_prev;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    speed_ctrl_get_stats(&sc_prev);
+    telem_scan();
+
+    int64_t next = k_uptime_ticks();
+
+    while (1)
+    {
+        next += k_ms_to_ticks_ceil64(TELEM_PERIOD_S * MSEC_PER_SEC);
+        k_sleep(K_TIMEOUT_ABS_TICKS(next));
+
+        speed_ctrl_stats_t sc;
+        uint32_t faults = 0;
+
+        speed_ctrl_get_stats(&sc);
+        if (adc_stream_overruns() != adc_overruns)
+        {
+            faults |= TELEM_FAULT_ADC_OVERRUN;
+        }
+        if (sc.overruns != sc_prev.overruns)
+        {
+            faults |= TELEM_FAULT_SPEED_OVERRUN;
+        }
+        if (sc.no_feedback != sc_prev.no_feedback)
+        {
+            faults |= TELEM_FAULT_SPEED_NO_FEEDBACK;
+        }
+        if (dlog_dropped() != log_dropped)
+        {
+            faults |= TELEM_FAULT_LOG_DROPPED;
+        }
+        adc_overruns = adc_stream_overruns();
+        log_dropped = dlog_dropped();
+        sc_prev = sc;
+
+        // Целые секунды наработки, остаток переходит в следующий период
+        uint32_t run_s = (global_motor_run_ms - run_mark_ms) / 1000;
+        run_mark_ms += run_s * 1000;
+
+        telem_append(global_vbat_mv, global_pwm_active ? global_duty_cycle : 0, run_s, faults);
+        telem_flush();
+    }
+}
+
+K_THREAD_DEFINE(telemetry_tid, TELEM_STACK_SIZE, telemetry_thread, NULL, NULL, NULL,
+                TELEM_PRIORITY, 0, TELEM_START_DELAY_MS);
+
+/**
+ * @brief Размер потока для чтения: блоки flash, очередь, текущий блок
+ * @return размер, байт, или -EAGAIN - журнал занят записью
+ */
+int telemetry_size(void)
+{
+    if (k_mutex_lock(&telem_mutex, K_MSEC(TELEM_READ_TIMEOUT_MS)))
+    {
+        return -EAGAIN;
+    }
+    uint32_t size = (telem_ring.count + telem_queue_count) * TELEM_BLOCK_SIZE;
+    if (telem_cur.hdr.count)
+    {
+        size += sizeof(telem_block_hdr_t) + telem_cur.hdr.len;
+    }
+    k_mutex_unlock(&telem_mutex);
+    return (int)size;
+}
+
+/**
+ * @brief Прочитать кусок потока телеметрии
+ * @return количество скопированных байт, 0 - конец, -EAGAIN - журнал занят записью
+ */
+int telemetry_read(uint32_t offset, void *buf, uint32_t len)
+{
+    uint8_t *dst = buf;
+    uint32_t done = 0;
+
+    if (k_mutex_lock(&telem_mutex, K_MSEC(TELEM_READ_TIMEOUT_MS)))
+    {
+        return -EAGAIN;
+    }
+
+    while (done < len)
+    {
+        uint32_t k = (offset + done) / TELEM_BLOCK_SIZE;
+        uint32_t in = (offset + done) % TELEM_BLOCK_SIZE;
+        const telem_block_t *b;
+        uint32_t avail = TELEM_BLOCK_SIZE;
+
+        if (k < telem_ring.count)
+        {
+            b = &telem_flash[(telem_ring.head + TELEM_BLOCKS - telem_ring.count + k) % TELEM_BLOCKS];
+        }
+        else if (k < telem_ring.count + telem_queue_count)
+        {
+            b = &telem_queue[(telem_queue_head + k - telem_ring.count) % TELEM_QUEUE_LEN];
+        }
+        else if (k == telem_ring.count + telem_queue_count && telem_cur.hdr.count)
+        {
+            b = &telem_cur;
+            avail = sizeof(telem_block_hdr_t) + telem_cur.hdr.len;
+        }
+        else
+        {
+            break;
+        }
+
+        if (in >= avail)
+        {
+            break;
+        }
+
+        uint32_t n = MIN(avail - in, len - done);
+        memcpy(dst + done, b->raw + in, n);
+        done += n;
+    }
+
+    k_mutex_unlock(&telem_mutex);
+    return (int)done;
+}
+
+void telemetry_get_stats(telemetry_stats_t *stats)
+{
+    k_mutex_lock(&telem_mutex, K_FOREVER);
+    *stats = telem_stats;
+    stats->flash_blocks = telem_ring.count;
+    k_mutex_unlock(&telem_mutex);
+}
@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+/*
+ * Журнал телеметрии во flash.
+ *
+ * Блоки по TELEM_BLOCK_SIZE байт, каждый самодостаточен: заголовок с
+ * абсолютными значениями первой записи, дальше записи по TELEM_PERIOD_S:
+ *   varint(zigzag(dVbat, мВ)) varint(zigzag(dDuty, %)) varint(мотор, с) varint(faults)
+ * Разности - к предыдущей записи того же блока, первая запись блока - нули.
+ */
+#define TELEM_PERIOD_S 300
+#define TELEM_BLOCK_SIZE 256
+#define TELEM_BLOCK_MAGIC 0x4C54 // "TL"
+
+#define TELEM_BLK_BOOT (1u << 0) // первый блок после старта, uptime отсчитан заново
+
+// Флаги сбоев за период
+#define TELEM_FAULT_ADC_OVERRUN (1u << 0)
+#define TELEM_FAULT_SPEED_OVERRUN (1u << 1)
+#define TELEM_FAULT_SPEED_NO_FEEDBACK (1u << 2)
+#define TELEM_FAULT_LOG_DROPPED (1u << 3)
+
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t count;      // записей в блоке
+    uint8_t len;        // байт записей после заголовка
+    uint32_t seq;       // номер блока, сквозной
+    uint32_t t0_s;      // uptime первой записи, с
+    uint16_t period_s;
+    uint16_t vbat_mv;   // значения первой записи
+    uint8_t duty;
+    uint8_t flags;      // TELEM_BLK_*
+    uint16_t crc;       // crc16_ccitt записей (len байт)
+} telem_block_hdr_t;
+
+#define TELEM_PAYLOAD_MAX (TELEM_BLOCK_SIZE - sizeof(telem_block_hdr_t))
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t blocks_written;
+    uint32_t dropped;     // записи, потерянные при переполнении очереди блоков
+    uint32_t erase_deferred;
+    uint16_t flash_blocks; // блоков с данными во flash
+} telemetry_stats_t;
+
+/*
+ * Чтение не ждёт запись во flash (стирание - десятки мс): если журнал
+ * занят дольше TELEM_READ_TIMEOUT_MS, возвращается -EAGAIN.
+ */
+#define TELEM_READ_TIMEOUT_MS 5
+
+int telemetry_size(void);
+int telemetry_read(uint32_t offset, void *buf, uint32_t len);
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#endif /* TELEMETRY_H_ */
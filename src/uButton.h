@@ -9,14 +9,15 @@ extern "C" {
     #include <zephyr/drivers/gpio.h>
 }
 
-class uButton : public uButtonVirt {
+template <class Timings, class Clock = uButtonUptimeClock>
+class uButtonGpioT : public uButtonT<Timings, Clock> {
    public:
-    uButton(const struct gpio_dt_spec& _button) : button(_button) {
+    uButtonGpioT(const struct gpio_dt_spec& _button) : button(_button) {
     }
 
     // вызывать в loop. Вернёт true при смене состояния
     bool tick() {
-        return uButtonVirt::pollDebounce(readButton());
+        return uButtonT<Timings, Clock>::pollDebounce(readButton());
     }
 
     // прочитать состояние кнопки
@@ -28,4 +29,6 @@ class uButton : public uButtonVirt {
     struct gpio_dt_spec button;
 };
 
-#endif // __cplusplus
\ No newline at end of file
+using uButton = uButtonGpioT<uButtonTimings<>>;
+
+#endif // __cplusplus
@@ -0,0 +1,158 @@
+#pragma once
+
+#ifdef __cplusplus
+
+#include "uButtonVirt.h"
+
+/*
+ * Клавиатура до 32 кнопок на одном порту GPIO.
+ *
+ * Порт читается целиком один раз за скан, антидребезг всех входов сразу -
+ * вертикальный счётчик: два 32-битных слова хранят двухбитный счётчик
+ * для каждого бита порта. Уровень принимается после 4 подряд одинаковых
+ * сканов, т.е. период скана ~ Timings::deb / 4.
+ *
+ * Автомат (uButtonFsm, тот же что у uButton) запускается только для кнопок,
+ * у которых сменился уровень или идёт жест. Данные кнопок - struct-of-arrays.
+ */
+
+// Без GPIO и часов: значение порта и время передаются в scan()
+template <uint8_t N, class Timings = uButtonTimings<>>
+class uButtonScanT {
+    static_assert(N > 0 && N <= 32, "uButtonScan supports 1..32 buttons");
+
+   public:
+    using State = uButtonState;
+
+    // период скана для заданного дебаунса, мс
+    static constexpr uint32_t scanPeriod = Timings::deb / 4 ? Timings::deb / 4 : 1;
+
+    // pins: номера выводов на порту, i-я кнопка - pins[i]; activeLow - маска выводов порта
+    uButtonScanT(const uint8_t (&pins)[N], uint32_t activeLow) : _invert(activeLow) {
+        for (uint8_t i = 0; i < 32; i++) _index[i] = 0xFF;
+        for (uint8_t i = 0; i < N; i++) {
+            _mask |= 1UL << pins[i];
+            _index[pins[i]] = i;
+            _pin[i] = pins[i];
+        }
+        _invert &= _mask;
+        _level = 0;
+        for (uint8_t i = 0; i < N; i++) {
+            _state[i] = State::Idle;
+            _clicks[i] = 0;
+            _steps[i] = 0;
+            _tmr[i] = 0;
+        }
+    }
+
+    // один скан по сырому значению порта. Вернёт маску кнопок (по индексу),
+    // у которых сменилось состояние автомата
+    uint32_t scan(uint32_t raw, uint32_t now) {
+        uint32_t sample = (raw ^ _invert) & _mask;
+
+        // вертикальный счётчик: считает сканы, в которых вход отличается
+        // от принятого уровня, сбрасывается при совпадении
+        uint32_t delta = sample ^ _level;
+        _cnt1 = (_cnt1 ^ _cnt0) & delta;
+        _cnt0 = ~_cnt0 & delta;
+        uint32_t toggle = delta & ~(_cnt0 | _cnt1);
+        _level ^= toggle;
+
+        // автомат нужен кнопкам со сменой уровня и с незаконченным жестом
+        uint32_t run = toggle | _busy;
+        uint32_t changed = 0;
+
+        while (run) {
+            uint8_t bit = __builtin_ctz(run);
+            uint8_t i = _index[bit];
+            run &= run - 1;
+
+            if (uButtonFsm<Timings>::poll(_state[i], _clicks[i], _steps[i], _tmr[i], now,
+                                          (_level >> bit) & 1)) {
+                changed |= 1UL << i;
+            }
+
+            if (_state[i] == State::Idle) _busy &= ~(1UL << bit);
+            else _busy |= 1UL << bit;
+        }
+
+        _events = changed;
+        return changed;
+    }
+
+    // есть кнопки с незаконченным жестом или недодебаунсенным входом
+    bool busy() {
+        return _busy || _cnt0 || _cnt1;
+    }
+
+    // принятый уровень: маска кнопок по индексу
+    uint32_t pressedMask() {
+        uint32_t m = 0;
+        for (uint8_t i = 0; i < N; i++) {
+            if ((_level >> _pin[i]) & 1) m |= 1UL << i;
+        }
+        return m;
+    }
+
+    // события последнего скана по индексу кнопки
+    bool changed(uint8_t i) { return (_events >> i) & 1; }
+    bool press(uint8_t i) { return _state[i] == State::Press; }
+    bool click(uint8_t i) { return _state[i] == State::Click; }
+    bool hold(uint8_t i) { return _state[i] == State::Hold; }
+    bool releaseHold(uint8_t i) { return _state[i] == State::ReleaseHold; }
+    bool step(uint8_t i) { return _state[i] == State::Step; }
+    bool releaseStep(uint8_t i) { return _state[i] == State::ReleaseStep; }
+    bool release(uint8_t i) { return _state[i] == State::Release; }
+    bool hasClicks(uint8_t i) { return _state[i] == State::Clicks; }
+    bool timeout(uint8_t i) { return _state[i] == State::Timeout; }
+
+    State getState(uint8_t i) { return _state[i]; }
+    uint8_t getClicks(uint8_t i) { return _clicks[i]; }
+    uint8_t getSteps(uint8_t i) { return _steps[i]; }
+
+   private:
+    // общие для всех кнопок, по битам порта
+    uint32_t _mask = 0;    // используемые выводы
+    uint32_t _invert = 0;  // активный низкий уровень
+    uint32_t _level = 0;   // принятый после антидребезга уровень (1 - нажата)
+    uint32_t _cnt0 = 0;    // вертикальный счётчик, младший бит
+    uint32_t _cnt1 = 0;    // вертикальный счётчик, старший бит
+    uint32_t _busy = 0;    // кнопки не в Idle
+    uint32_t _events = 0;  // по индексу: сменили состояние в последнем скане
+    uint8_t _index[32];    // бит порта -> индекс кнопки
+
+    // по индексу кнопки
+    uint8_t _pin[N];
+    State _state[N];
+    uint8_t _clicks[N];
+    uint8_t _steps[N];
+    uint32_t _tmr[N];
+};
+
+#ifdef __ZEPHYR__
+extern "C" {
+    #include <zephyr/drivers/gpio.h>
+}
+
+// Сканер порта GPIO: tick() раз в scanPeriod мс
+template <uint8_t N, class Timings = uButtonTimings<>, class Clock = uButtonUptimeClock>
+class uButtonPortScan : public uButtonScanT<N, Timings> {
+   public:
+    uButtonPortScan(const struct device* port, const uint8_t (&pins)[N], uint32_t activeLow)
+        : uButtonScanT<N, Timings>(pins, activeLow), _port(port) {
+    }
+
+    // прочитать порт и прогнать автоматы. Вернёт маску кнопок со сменой состояния
+    uint32_t tick() {
+        gpio_port_value_t raw;
+
+        if (gpio_port_get_raw(_port, &raw)) return 0;
+        return this->scan(raw, Clock::now());
+    }
+
+   private:
+    const struct device* _port;
+};
+#endif
+
+#endif // __cplusplus
@@ -3,6 +3,7 @@
 #ifdef __cplusplus
 
 //#include "define.h"
+#include <stdint.h>
 
 #ifndef UB_DEB_TIME
 #define UB_DEB_TIME 50  // дебаунс
@@ -28,27 +29,156 @@
 #define UB_TOUT_TIME 1000  // таймаут события "таймаут"
 #endif
 
-class uButtonVirt {
+#ifndef UB_EDGE_RING
+#define UB_EDGE_RING 8  // фронтов в очереди из прерывания, степень двойки
+#endif
+
+/*
+ * uButtonT<Timings, Clock>: времена задаются типом на каждый экземпляр,
+ * часы - тип со static uint32_t now(), мс. Время 32-битное и сравнивается
+ * по разности, переполнение через 49 дней не мешает. Без Zephyr собирается
+ * на хосте с виртуальными часами.
+ *
+ * Два режима работы:
+ *  - опрос: tick()/pollDebounce() с постоянным периодом;
+ *  - по фронтам: pushEdgeISR() из прерывания кладёт фронт с меткой времени,
+ *    process(now) прогоняет автомат до now, nextDeadline() говорит,
+ *    когда вызвать process() в следующий раз. Без фронтов и сроков не будит.
+ * События (press(), click(), ...) одинаковы в обоих режимах.
+ */
+
+// Времена кнопки, мс. По умолчанию - макросы UB_*
+template <uint16_t Deb = UB_DEB_TIME, uint16_t Hold = UB_HOLD_TIME, uint16_t StepTime = UB_STEP_TIME,
+          uint16_t StepPrd = UB_STEP_PRD, uint16_t Click = UB_CLICK_TIME, uint16_t Tout = UB_TOUT_TIME>
+struct uButtonTimings {
+    static constexpr uint16_t deb = Deb;
+    static constexpr uint16_t hold = Hold;
+    static constexpr uint16_t stepTime = StepTime;
+    static constexpr uint16_t stepPrd = StepPrd;
+    static constexpr uint16_t click = Click;
+    static constexpr uint16_t tout = Tout;
+};
+
+enum class uButtonState : uint8_t {
+    Idle,          // простаивает [состояние]
+    Press,         // нажатие [событие]
+    Click,         // клик (отпущено до удержания) [событие]
+    WaitHold,      // ожидание удержания [состояние]
+    Hold,          // удержание [событие]
+    ReleaseHold,   // отпущено до импульсов [событие]
+    WaitStep,      // ожидание импульсов [состояние]
+    Step,          // импульс [событие]
+    WaitNextStep,  // ожидание следующего импульса [состояние]
+    ReleaseStep,   // отпущено после импульсов [событие]
+    Release,       // отпущено (в любом случае) [событие]
+    WaitClicks,    // ожидание кликов [состояние]
+    Clicks,        // клики [событие]
+    WaitTimeout,   // ожидание таймаута [состояние]
+    Timeout,       // таймаут [событие]
+};
+
+// Автомат кнопки без хранения: одинаковый для uButtonT и uButtonScan
+template <class Timings>
+struct uButtonFsm {
+    // один шаг автомата. Вернёт true при смене состояния
+    static bool poll(uButtonState& state, uint8_t& clicks, uint8_t& steps, uint32_t& tmr,
+                     uint32_t now, bool pressed) {
+        using State = uButtonState;
+        State pstate = state;
+
+        switch (state) {
+            case State::Idle:
+                if (pressed) state = State::Press;
+                break;
+
+            case State::Press:
+                state = State::WaitHold;
+                tmr = now;
+                break;
+
+            case State::WaitHold:
+                if (!pressed) {
+                    state = State::Click;
+                    ++clicks;
+                } else if ((uint32_t)(now - tmr) >= Timings::hold) {
+                    state = State::Hold;
+                    tmr = now;
+                }
+                break;
+
+            case State::Hold:
+                state = State::WaitStep;
+                break;
+
+            case State::WaitStep:
+                if (!pressed) state = State::ReleaseHold;
+                else if ((uint32_t)(now - tmr) >= Timings::stepTime) {
+                    state = State::Step;
+                    tmr = now;
+                }
+                break;
+
+            case State::Step:
+                state = State::WaitNextStep;
+                break;
+
+            case State::WaitNextStep:
+                if (!pressed) state = State::ReleaseStep;
+                else if ((uint32_t)(now - tmr) >= Timings::stepPrd) {
+                    state = State::Step;
+                    ++steps;
+                    tmr = now;
+                }
+                break;
+
+            case State::ReleaseHold:
+            case State::ReleaseStep:
+                clicks = 0;
+                // fall
+
+            case State::Click:
+                state = State::Release;
+                break;
+
+            case State::Release:
+                steps = 0;
+                state = clicks ? State::WaitClicks : State::WaitTimeout;
+                tmr = now;
+                break;
+
+            case State::WaitClicks:
+                if (pressed) state = State::Press;
+                else if ((uint32_t)(now - tmr) >= Timings::click) {
+                    state = State::Clicks;
+                    tmr = now;
+                }
+                break;
+
+            case State::Clicks:
+                clicks = 0;
+                state = State::WaitTimeout;
+                break;
+
+            case State::WaitTimeout:
+                if (pressed) state = State::Press;
+                else if ((uint32_t)(now - tmr) >= Timings::tout) state = State::Timeout;
+                break;
+
+            case State::Timeout:
+                state = State::Idle;
+                break;
+        }
+
+        return pstate != state;
+    }
+};
+
+template <class Timings, class Clock>
+class uButtonT {
    public:
-    enum class State : uint8_t {
-        Idle,          // простаивает [состояние]
-        Press,         // нажатие [событие]
-        Click,         // клик (отпущено до удержания) [событие]
-        WaitHold,      // ожидание удержания [состояние]
-        Hold,          // удержание [событие]
-        ReleaseHold,   // отпущено до импульсов [событие]
-        WaitStep,      // ожидание импульсов [состояние]
-        Step,          // импульс [событие]
-        WaitNextStep,  // ожидание следующего импульса [состояние]
-        ReleaseStep,   // отпущено после импульсов [событие]
-        Release,       // отпущено (в любом случае) [событие]
-        WaitClicks,    // ожидание кликов [состояние]
-        Clicks,        // клики [событие]
-        WaitTimeout,   // ожидание таймаута [состояние]
-        Timeout,       // таймаут [событие]
-    };
+    using State = uButtonState;
 
-    uButtonVirt() : _press(0), _steps(0), _state(State::Idle), _clicks(0) {}
+    uButtonT() : _press(0), _steps(0), _state(State::Idle), _clicks(0) {}
 
     // сбросить состояние (принудительно закончить обработку)
     void reset() {
@@ -212,7 +342,7 @@ class uButtonVirt {
             case State::WaitStep:
             case State::Step:
             case State::WaitNextStep:
-                return UB_HOLD_TIME + holdFor();
+                return Timings::hold + holdFor();
 
             default: return 0;
         }
@@ -231,7 +361,7 @@ class uButtonVirt {
 
             case State::Step:
             case State::WaitNextStep:
-                return UB_STEP_TIME + stepFor();
+                return Timings::stepTime + stepFor();
 
             default:
                 return 0;
@@ -248,7 +378,7 @@ class uButtonVirt {
         switch (_state) {
             case State::Step:
             case State::WaitNextStep:
-                return _steps * UB_STEP_PRD + _getTime();
+                return _steps * Timings::stepPrd + _getTime();
 
             default:
                 return 0;
@@ -278,124 +408,198 @@ class uButtonVirt {
     // кнопка нажата в прерывании
     void pressISR() {
         _press = 1;
-        _deb = k_uptime_get();
+        _deb = Clock::now();
+        _debActive = true;
     }
 
     // обработка с антидребезгом. Вернёт true при смене состояния
     bool pollDebounce(bool pressed) {
+        _now = Clock::now();
         if (_press == pressed) {
-            _deb = 0;
+            _debActive = false;
         } else {
-            if (!_deb) _deb = k_uptime_get();
-            else if ((k_uptime_get() - _deb) >= UB_DEB_TIME) _press = pressed;
+            if (!_debActive) {
+                _deb = _now;
+                _debActive = true;
+            } else if ((uint32_t)(_now - _deb) >= Timings::deb) {
+                _press = pressed;
+            }
         }
-        return poll(_press);
+        return _poll(_press);
     }
 
     // обработка. Вернёт true при смене состояния
     bool poll(bool pressed) {
-        State pstate = _state;
+        _now = Clock::now();
+        return _poll(pressed);
+    }
 
-        switch (_state) {
-            case State::Idle:
-                if (pressed) _state = State::Press;
-                break;
+    // фронт на входе (вызывать из прерывания): уровень после фронта и время, мс
+    void pushEdgeISR(bool level, uint32_t t) {
+        uint8_t head = __atomic_load_n(&_edgeHead, __ATOMIC_RELAXED);
+        uint8_t tail = __atomic_load_n(&_edgeTail, __ATOMIC_ACQUIRE);
 
-            case State::Press:
-                _state = State::WaitHold;
-                _resetTime();
-                break;
+        if ((uint8_t)(head - tail) >= UB_EDGE_RING) {
+            // очередь полна (дребезг): запомнить только последний уровень
+            __atomic_store_n(&_lostLevel, level, __ATOMIC_RELAXED);
+            __atomic_store_n(&_edgeLost, true, __ATOMIC_RELEASE);
+            return;
+        }
 
-            case State::WaitHold:
-                if (!pressed) {
-                    _state = State::Click;
-                    ++_clicks;
-                } else if (_getTime() >= UB_HOLD_TIME) {
-                    _state = State::Hold;
-                    _resetTime();
-                }
-                break;
+        _edges[head & (UB_EDGE_RING - 1)] = {t, level};
+        __atomic_store_n(&_edgeHead, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+    }
+
+    // обработка фронтов и сроков до момента now, мс. Вернёт true при смене состояния:
+    // вызывать повторно, проверяя события после каждого true
+    bool process(uint32_t now) {
+        for (;;) {
+            // событие живёт ровно один шаг автомата
+            if (_isEvent()) return _pollAt(_now);
+
+            uint32_t due;
+            bool hasDue = _stateDeadline(due);
+            uint32_t deb = _rawSince + Timings::deb;
+            bool hasDeb = _raw != _press;
+            Edge e;
+            bool edge = _peekEdge(e, now);
+
+            // уровень устоялся раньше следующего фронта и срока состояния
+            if (hasDeb && _after(now, deb) && (!hasDue || _after(due, deb)) && (!edge || _after(e.t, deb))) {
+                _press = _raw;
+                return _pollAt(deb);
+            }
+
+            // фронт до срока: при равенстве срок наступает раньше, как при опросе
+            if (edge && _after(now, e.t) && (!hasDue || !_after(e.t, due))) {
+                __atomic_store_n(&_edgeTail, (uint8_t)(_edgeTail + 1), __ATOMIC_RELEASE);
+                _raw = e.level;
+                _rawSince = e.t;
+                continue;
+            }
+
+            if (hasDue && _after(now, due)) return _pollAt(due);
+
+            return false;
+        }
+    }
 
-            case State::Hold:
-                _state = State::WaitStep;
-                break;
+    // когда вызвать process() в следующий раз, мс; false - только по фронту
+    bool nextDeadline(uint32_t& at) {
+        if (_isEvent() || _edgeTail != __atomic_load_n(&_edgeHead, __ATOMIC_ACQUIRE) ||
+            __atomic_load_n(&_edgeLost, __ATOMIC_ACQUIRE)) {
+            at = _now;
+            return true;
+        }
 
-            case State::WaitStep:
-                if (!pressed) _state = State::ReleaseHold;
-                else if (_getTime() >= UB_STEP_TIME) {
-                    _state = State::Step;
-                    _resetTime();
-                }
-                break;
+        bool hasDue = _stateDeadline(at);
+        if (_raw != _press && (!hasDue || _after(at, _rawSince + Timings::deb))) {
+            at = _rawSince + Timings::deb;
+            return true;
+        }
+        return hasDue;
+    }
 
-            case State::Step:
-                _state = State::WaitNextStep;
-                break;
+   private:
+    struct Edge {
+        uint32_t t;
+        bool level;
+    };
 
-            case State::WaitNextStep:
-                if (!pressed) _state = State::ReleaseStep;
-                else if (_getTime() >= UB_STEP_PRD) {
-                    _state = State::Step;
-                    ++_steps;
-                    _resetTime();
-                }
-                break;
+    // a не раньше b с учётом переполнения
+    static bool _after(uint32_t a, uint32_t b) {
+        return (int32_t)(a - b) >= 0;
+    }
 
-            case State::ReleaseHold:
-            case State::ReleaseStep:
-                _clicks = 0;
-                // fall
+    bool _poll(bool pressed) {
+        return uButtonFsm<Timings>::poll(_state, _clicks, _steps, _tmr, _now, pressed);
+    }
 
-            case State::Click:
-                _state = State::Release;
-                break;
+    bool _pollAt(uint32_t t) {
+        _now = t;
+        return _poll(_press);
+    }
 
+    // состояние-событие, которое сменится на следующем шаге без ожидания
+    bool _isEvent() {
+        switch (_state) {
+            case State::Press:
+            case State::Click:
+            case State::Hold:
+            case State::ReleaseHold:
+            case State::Step:
+            case State::ReleaseStep:
             case State::Release:
-                _steps = 0;
-                _state = _clicks ? State::WaitClicks : State::WaitTimeout;
-                _resetTime();
-                break;
-
-            case State::WaitClicks:
-                if (pressed) _state = State::Press;
-                else if (_getTime() >= UB_CLICK_TIME) {
-                    _state = State::Clicks;
-                    _resetTime();
-                }
-                break;
-
             case State::Clicks:
-                _clicks = 0;
-                _state = State::WaitTimeout;
-                break;
+            case State::Timeout:
+                return true;
 
-            case State::WaitTimeout:
-                if (pressed) _state = State::Press;
-                else if (_getTime() >= UB_TOUT_TIME) _state = State::Timeout;
-                break;
+            default:
+                return false;
+        }
+    }
 
-            case State::Timeout:
-                _state = State::Idle;
-                break;
+    // момент, когда состояние ожидания сменится само
+    bool _stateDeadline(uint32_t& at) {
+        switch (_state) {
+            case State::WaitHold: at = _tmr + Timings::hold; return true;
+            case State::WaitStep: at = _tmr + Timings::stepTime; return true;
+            case State::WaitNextStep: at = _tmr + Timings::stepPrd; return true;
+            case State::WaitClicks: at = _tmr + Timings::click; return true;
+            case State::WaitTimeout: at = _tmr + Timings::tout; return true;
+            default: return false;
         }
+    }
 
-        return pstate != _state;
+    // следующий фронт из очереди; потерянный при переполнении - с временем now
+    bool _peekEdge(Edge& e, uint32_t now) {
+        if (_edgeTail != __atomic_load_n(&_edgeHead, __ATOMIC_ACQUIRE)) {
+            e = _edges[_edgeTail & (UB_EDGE_RING - 1)];
+            return true;
+        }
+        if (__atomic_exchange_n(&_edgeLost, false, __ATOMIC_ACQUIRE)) {
+            // в очередь он уже не попадёт: применить сразу
+            _raw = __atomic_load_n(&_lostLevel, __ATOMIC_RELAXED);
+            _rawSince = now;
+        }
+        return false;
     }
 
-   private:
-    int64_t _tmr = 0;
-    int64_t  _deb = 0;
+    uint32_t _tmr = 0;
+    uint32_t _deb = 0;
+    uint32_t _now = 0;  // время текущего шага автомата
+    bool _debActive = false;
     uint8_t _press;
     uint8_t _steps;
     State _state;
     uint8_t _clicks;
 
-    int64_t _getTime() {
-        return k_uptime_get() - _tmr;
+    // режим по фронтам
+    Edge _edges[UB_EDGE_RING];
+    uint8_t _edgeHead = 0;  // пишет только прерывание
+    uint8_t _edgeTail = 0;  // пишет только process()
+    bool _edgeLost = false;
+    bool _lostLevel = false;
+    bool _raw = false;        // уровень после последнего фронта
+    uint32_t _rawSince = 0;   // время последнего фронта
+
+    uint32_t _getTime() {
+        return _now - _tmr;
     }
     void _resetTime() {
-        _tmr = k_uptime_get();
+        _tmr = _now;
+    }
+};
+
+#ifdef __ZEPHYR__
+// Часы по умолчанию: k_uptime_get_32(), без 64-битной арифметики
+struct uButtonUptimeClock {
+    static uint32_t now() {
+        return k_uptime_get_32();
     }
 };
 
+using uButtonVirt = uButtonT<uButtonTimings<>, uButtonUptimeClock>;
+#endif
+
 #endif // __cplusplus
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+ * Смена двойного буфера SAADC (src/adc_dma.h) на поддельном блоке регистров.
+ *
+ * Модель железа: START защёлкивает RESULT.PTR и выставляет STARTED,
+ * каждый SAMPLE пишет один отсчёт в защёлкнутый буфер, на MAXCNT - END и
+ * сразу START (PPI END -> START, как в adc_dma_begin()).
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct
+{
+    volatile uint32_t EVENTS_STARTED;
+    volatile uint32_t EVENTS_END;
+    struct
+    {
+        volatile uintptr_t PTR;
+        volatile uint32_t MAXCNT;
+        volatile uint32_t AMOUNT;
+    } RESULT;
+} fake_saadc_t;
+
+#define ADC_DMA_REGS fake_saadc_t
+#include "adc_dma.h"
+#include "sample_ring.h"
+
+#define BUF_LEN 4
+
+static fake_saadc_t saadc;
+static int16_t buf[2][BUF_LEN];
+static adc_dma_t dma;
+static sample_ring_t ring;
+
+static int16_t *hw_ptr; // защёлкнутый DMA буфер
+static uint32_t hw_cnt;
+static int16_t hw_value;
+
+static void hw_start(void)
+{
+    hw_ptr = (int16_t *)saadc.RESULT.PTR;
+    hw_cnt = 0;
+    saadc.EVENTS_STARTED = 1;
+}
+
+static void hw_sample(void)
+{
+    hw_ptr[hw_cnt++] = hw_value++;
+    if (hw_cnt == saadc.RESULT.MAXCNT)
+    {
+        saadc.RESULT.AMOUNT = hw_cnt;
+        saadc.EVENTS_END = 1;
+        hw_start();
+    }
+}
+
+// ISR потокового режима: заполненный буфер - в кольцо
+static const int16_t *isr(void)
+{
+    uint32_t amount = 0;
+    const int16_t *done = adc_dma_irq(&dma, &saadc, &amount);
+
+    if (done)
+    {
+        // DMA в этот момент должен писать другой буфер
+        TEST_ASSERT_TRUE(done != hw_ptr);
+        sample_ring_put(&ring, done, amount);
+    }
+    return done;
+}
+
+void setUp(void)
+{
+    memset(&saadc, 0, sizeof(saadc));
+    memset(buf, 0xA5, sizeof(buf));
+    hw_value = 0;
+    sample_ring_reset(&ring);
+    adc_dma_reset(&dma, buf[0], buf[1]);
+
+    saadc.RESULT.PTR = (uintptr_t)buf[0];
+    saadc.RESULT.MAXCNT = BUF_LEN;
+    hw_start();
+}
+
+void tearDown(void)
+{
+}
+
+static void expect_sequence(int16_t first, uint32_t n)
+{
+    int16_t out[SAMPLE_RING_LEN];
+
+    TEST_ASSERT_EQUAL_UINT32(n, sample_ring_get(&ring, out, SAMPLE_RING_LEN));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(first + (int16_t)i, out[i]);
+    }
+}
+
+// ISR после каждого отсчёта: буферы чередуются, ничего не теряется
+static void test_handoff_every_sample(void)
+{
+    isr();
+    for (int i = 0; i < 10 * BUF_LEN; i++)
+    {
+        hw_sample();
+        isr();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(10, dma.done);
+    TEST_ASSERT_EQUAL_UINT32(0, dma.missed);
+    expect_sequence(0, 10 * BUF_LEN);
+}
+
+// ISR только на границах буферов: END и STARTED приходят вместе
+static void test_handoff_end_with_started(void)
+{
+    isr();
+    for (int b = 0; b < 8; b++)
+    {
+        for (int i = 0; i < BUF_LEN; i++)
+        {
+            hw_sample();
+        }
+        TEST_ASSERT_TRUE(saadc.EVENTS_END && saadc.EVENTS_STARTED);
+        TEST_ASSERT_EQUAL_PTR(buf[b & 1], isr());
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(8, dma.done);
+    TEST_ASSERT_EQUAL_UINT32(0, dma.missed);
+    expect_sequence(0, 8 * BUF_LEN);
+}
+
+// STARTED первого буфера не обработан до END: DMA пишет тот же буфер заново
+static void test_missed_handoff_counted(void)
+{
+    for (int i = 0; i < BUF_LEN; i++)
+    {
+        hw_sample();
+    }
+    TEST_ASSERT_EQUAL_PTR(buf[0], hw_ptr);
+
+    TEST_ASSERT_NULL(isr());
+    TEST_ASSERT_EQUAL_UINT32(1, dma.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, dma.done);
+
+    // Дальше смена снова идёт, первый отданный буфер - перезаписанный
+    for (int i = 0; i < 2 * BUF_LEN; i++)
+    {
+        hw_sample();
+        isr();
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, dma.done);
+    TEST_ASSERT_EQUAL_UINT32(1, dma.missed);
+    expect_sequence(BUF_LEN, 2 * BUF_LEN);
+}
+
+// Потребитель не читает: лишние отсчёты считаются в кольце, смена не страдает
+static void test_ring_overrun(void)
+{
+    const uint32_t buffers = SAMPLE_RING_LEN / BUF_LEN + 4;
+
+    isr();
+    for (uint32_t i = 0; i < buffers * BUF_LEN; i++)
+    {
+        hw_sample();
+        isr();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(buffers, dma.done);
+    TEST_ASSERT_EQUAL_UINT32(0, dma.missed);
+    TEST_ASSERT_EQUAL_UINT32(4 * BUF_LEN, ring.overruns);
+    expect_sequence(0, SAMPLE_RING_LEN);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_handoff_every_sample);
+    RUN_TEST(test_handoff_end_with_started);
+    RUN_TEST(test_missed_handoff_counted);
+    RUN_TEST(test_ring_overrun);
+    return UNITY_END();
+}
@@ -0,0 +1,318 @@
+/*
+ * Автомат кнопки (src/uButtonVirt.h): записанные фронты прогоняются
+ * в режиме по фронтам так же, как button_work_handler() в button.cpp
+ * (process() до now, следующий запуск по nextDeadline()), и в режиме опроса
+ * pollDebounce() раз в 1 мс. Последовательность событий должна совпадать,
+ * моменты событий в режиме по фронтам - с ожидаемыми.
+ *
+ * Журнал событий - строка "<событие><клики>@<мс>": P press, C click,
+ * H hold, h releaseHold, S step, s releaseStep, R release, N clicks,
+ * T timeout.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "uButtonVirt.h"
+
+struct VClock
+{
+    static uint32_t t;
+    static uint32_t now() { return t; }
+};
+uint32_t VClock::t;
+
+using Button = uButtonT<uButtonTimings<>, VClock>;
+
+struct edge_t
+{
+    uint32_t t;
+    bool level;
+};
+
+#define LOG_LEN 512
+
+struct event_log_t
+{
+    char buf[LOG_LEN];
+    size_t len;
+    bool times;
+};
+
+static char state_char(uButtonState s)
+{
+    switch (s)
+    {
+    case uButtonState::Press: return 'P';
+    case uButtonState::Click: return 'C';
+    case uButtonState::Hold: return 'H';
+    case uButtonState::ReleaseHold: return 'h';
+    case uButtonState::Step: return 'S';
+    case uButtonState::ReleaseStep: return 's';
+    case uButtonState::Release: return 'R';
+    case uButtonState::Clicks: return 'N';
+    case uButtonState::Timeout: return 'T';
+    default: return 0; // состояние ожидания, не событие
+    }
+}
+
+static void log_event(event_log_t *log, uButtonState s, uint8_t clicks, uint32_t t)
+{
+    char c = state_char(s);
+
+    if (!c)
+    {
+        return;
+    }
+    if (log->times)
+    {
+        log->len += snprintf(log->buf + log->len, LOG_LEN - log->len, "%s%c%u@%u",
+                             log->len ? " " : "", c, clicks, (unsigned)t);
+    }
+    else
+    {
+        log->len += snprintf(log->buf + log->len, LOG_LEN - log->len, "%s%c%u",
+                             log->len ? " " : "", c, clicks);
+    }
+}
+
+/*
+ * Режим по фронтам. Обработчик запускается на каждом фронте (как из
+ * button_isr()) и по сроку из nextDeadline(). burst фронтов подряд кладутся
+ * без обработчика между ними - так прерывание обгоняет поток при дребезге.
+ */
+template <class B>
+static void replay_edges(B &b, const edge_t *e, size_t n, uint32_t end, event_log_t *log,
+                         size_t burst = 1)
+{
+    uint32_t wake = 0;
+    bool armed = false;
+    size_t i = 0;
+
+    for (;;)
+    {
+        bool edge_next = i < n && (!armed || (int32_t)(e[i].t - wake) <= 0);
+        uint32_t now;
+
+        if (!edge_next && !armed)
+        {
+            break;
+        }
+
+        now = edge_next ? e[i].t : wake;
+        if ((int32_t)(now - end) > 0)
+        {
+            break;
+        }
+
+        if (edge_next)
+        {
+            size_t last = i + (burst > 1 && i == 0 ? burst : 1);
+
+            for (; i < last && i < n; i++)
+            {
+                b.pushEdgeISR(e[i].level, e[i].t);
+            }
+            now = e[i - 1].t;
+        }
+
+        while (b.process(now))
+        {
+            log_event(log, b.getState(), b.getClicks(), now);
+        }
+        armed = b.nextDeadline(wake);
+        if (armed && (int32_t)(wake - now) < 0)
+        {
+            wake = now;
+        }
+    }
+}
+
+// Режим опроса: pollDebounce() раз в 1 мс с уровнем по записи фронтов
+template <class B>
+static void replay_poll(B &b, const edge_t *e, size_t n, uint32_t start, uint32_t end, event_log_t *log)
+{
+    bool level = false;
+    size_t i = 0;
+
+    for (VClock::t = start; VClock::t != end; VClock::t++)
+    {
+        while (i < n && e[i].t <= VClock::t)
+        {
+            level = e[i++].level;
+        }
+        if (b.pollDebounce(level))
+        {
+            log_event(log, b.getState(), b.getClicks(), VClock::t);
+        }
+    }
+}
+
+/*
+ * Прогнать запись в обоих режимах. expected - журнал режима по фронтам
+ * с моментами, режим опроса сверяется по событиям без моментов.
+ */
+template <class Timings = uButtonTimings<>>
+static void check_trace(const char *expected, const edge_t *e, size_t n, uint32_t end, size_t burst = 1)
+{
+    uButtonT<Timings, VClock> edge_btn, poll_btn;
+    event_log_t edge_log = {{0}, 0, true};
+    event_log_t edge_seq = {{0}, 0, false};
+    event_log_t poll_seq = {{0}, 0, false};
+    const char *p = expected;
+
+    replay_edges(edge_btn, e, n, end, &edge_log, burst);
+    TEST_ASSERT_EQUAL_STRING(expected, edge_log.buf);
+    TEST_ASSERT_FALSE(edge_btn.busy());
+
+    // тот же журнал без моментов
+    while (*p)
+    {
+        const char *at = strchr(p, '@');
+        const char *next = strchr(p, ' ');
+
+        edge_seq.len += snprintf(edge_seq.buf + edge_seq.len, LOG_LEN - edge_seq.len, "%s%.*s",
+                                 edge_seq.len ? " " : "", (int)(at - p), p);
+        p = next ? next + 1 : p + strlen(p);
+    }
+
+    replay_poll(poll_btn, e, n, 0, end, &poll_seq);
+    TEST_ASSERT_EQUAL_STRING(edge_seq.buf, poll_seq.buf);
+    TEST_ASSERT_FALSE(poll_btn.busy());
+}
+
+void setUp(void)
+{
+    VClock::t = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Клик с дребезгом на обоих фронтах
+static void test_single_click_bounce(void)
+{
+    static const edge_t trace[] = {
+        {100, 1}, {102, 0}, {103, 1}, {107, 0}, {108, 1}, // дребезг нажатия
+        {300, 0}, {301, 1}, {304, 0},                     // дребезг отпускания
+    };
+
+    check_trace("P0@158 C1@354 R1@354 N1@854 T0@1854", trace, sizeof(trace) / sizeof(trace[0]), 3000);
+}
+
+// Два клика: одно событие Clicks с двумя кликами
+static void test_double_click(void)
+{
+    static const edge_t trace[] = {{100, 1}, {200, 0}, {350, 1}, {450, 0}};
+
+    check_trace("P0@150 C1@250 R1@250 P1@400 C2@500 R2@500 N2@1000 T0@2000", trace,
+                sizeof(trace) / sizeof(trace[0]), 3000);
+}
+
+// Удержание с импульсами: Hold через 1000 мс, Step через 400, дальше раз в 1000
+static void test_hold_steps(void)
+{
+    static const edge_t trace[] = {{100, 1}, {3000, 0}};
+
+    check_trace("P0@150 H0@1150 S0@1550 S0@2550 s0@3050 R0@3050 T0@4050", trace,
+                sizeof(trace) / sizeof(trace[0]), 5000);
+}
+
+// Клик + удержание и двойной клик + удержание: клики перед Hold сохраняются
+static void test_clicks_then_hold(void)
+{
+    static const edge_t trace[] = {{100, 1}, {200, 0}, {300, 1}, {1400, 0}};
+    static const edge_t trace2[] = {{100, 1}, {200, 0}, {300, 1}, {400, 0}, {500, 1}, {1700, 0}};
+
+    check_trace("P0@150 C1@250 R1@250 P1@350 H1@1350 h1@1450 R0@1450 T0@2450", trace,
+                sizeof(trace) / sizeof(trace[0]), 3000);
+    check_trace("P0@150 C1@250 R1@250 P1@350 C2@450 R2@450 P2@550 H2@1550 h2@1750 R0@1750 T0@2750",
+                trace2, sizeof(trace2) / sizeof(trace2[0]), 4000);
+}
+
+// Короткий импульс меньше дебаунса не даёт событий
+static void test_glitch_ignored(void)
+{
+    static const edge_t trace[] = {{100, 1}, {130, 0}, {500, 1}, {510, 0}};
+    Button b;
+    event_log_t log = {{0}, 0, true};
+    uint32_t at;
+
+    replay_edges(b, trace, sizeof(trace) / sizeof(trace[0]), 2000, &log);
+    TEST_ASSERT_EQUAL_STRING("", log.buf);
+    TEST_ASSERT_FALSE(b.busy());
+    TEST_ASSERT_FALSE(b.nextDeadline(at));
+}
+
+// Дребезг больше UB_EDGE_RING фронтов до запуска обработчика: берётся последний уровень
+static void test_edge_ring_overflow(void)
+{
+    edge_t trace[2 * UB_EDGE_RING + 2];
+    size_t n = 0;
+    Button b;
+    event_log_t log = {{0}, 0, true};
+
+    for (uint32_t i = 0; i < 2 * UB_EDGE_RING + 1; i++)
+    {
+        trace[n++] = {100 + i, (i & 1) == 0};
+    }
+    trace[n++] = {400, 0};
+
+    replay_edges(b, trace, n, 3000, &log, 2 * UB_EDGE_RING + 1);
+    TEST_ASSERT_EQUAL_STRING("P0@166 C1@450 R1@450 N1@950 T0@1950", log.buf);
+}
+
+// Время 32-битное: жест через переполнение счётчика мс
+static void test_uptime_wrap(void)
+{
+    static const edge_t trace[] = {{0xFFFFFF00u, 1}, {0xFFFFFF00u + 200, 0}};
+    Button b;
+    event_log_t log = {{0}, 0, false};
+
+    replay_edges(b, trace, sizeof(trace) / sizeof(trace[0]), 0xFFFFFF00u + 3000, &log);
+    TEST_ASSERT_EQUAL_STRING("P0 C1 R1 N1 T0", log.buf);
+}
+
+// Свои времена на экземпляр (uButtonTimings): дебаунс 20, удержание 300,
+// первый импульс через 200, дальше раз в 100, клики 250, таймаут 400
+using FastTimings = uButtonTimings<20, 300, 200, 100, 250, 400>;
+
+static void test_custom_timings(void)
+{
+    static const edge_t hold[] = {{100, 1}, {900, 0}};
+    static const edge_t clicks[] = {{100, 1}, {150, 0}, {200, 1}, {250, 0}, {300, 1}, {350, 0}};
+
+    check_trace<FastTimings>("P0@120 H0@420 S0@620 S0@720 S0@820 s0@920 R0@920 T0@1320", hold,
+                             sizeof(hold) / sizeof(hold[0]), 2000);
+    check_trace<FastTimings>("P0@120 C1@170 R1@170 P1@220 C2@270 R2@270 P2@320 C3@370 R3@370 N3@620 T0@1020",
+                             clicks, sizeof(clicks) / sizeof(clicks[0]), 2000);
+}
+
+// Одна запись на кнопках с разными временами: со стандартными это клик,
+// с короткими - удержание
+static void test_timings_per_instance(void)
+{
+    static const edge_t trace[] = {{100, 1}, {450, 0}};
+
+    check_trace("P0@150 C1@500 R1@500 N1@1000 T0@2000", trace, sizeof(trace) / sizeof(trace[0]), 3000);
+    check_trace<FastTimings>("P0@120 H0@420 h0@470 R0@470 T0@870", trace, sizeof(trace) / sizeof(trace[0]),
+                             3000);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_click_bounce);
+    RUN_TEST(test_double_click);
+    RUN_TEST(test_hold_steps);
+    RUN_TEST(test_clicks_then_hold);
+    RUN_TEST(test_glitch_ignored);
+    RUN_TEST(test_edge_ring_overflow);
+    RUN_TEST(test_uptime_wrap);
+    RUN_TEST(test_custom_timings);
+    RUN_TEST(test_timings_per_instance);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+/*
+ * Сканер клавиатуры (src/uButtonScan.h): записанные фронты нескольких кнопок
+ * собираются в значения порта и прогоняются через scan() с периодом
+ * scanPeriod. События каждой кнопки сверяются с uButtonT в режиме опроса
+ * на той же записи: автомат общий, отличается только антидребезг.
+ *
+ * Журнал событий - строка "<событие><клики>@<мс>": P press, C click,
+ * H hold, h releaseHold, S step, s releaseStep, R release, N clicks,
+ * T timeout.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "uButtonScan.h"
+
+struct VClock
+{
+    static uint32_t t;
+    static uint32_t now() { return t; }
+};
+uint32_t VClock::t;
+
+struct edge_t
+{
+    uint32_t t;
+    bool level; // 1 - нажата
+};
+
+struct trace_t
+{
+    const edge_t *e;
+    size_t n;
+};
+
+#define LOG_LEN 256
+#define KEYS 3
+
+using Scan = uButtonScanT<KEYS>;
+
+static const uint8_t pins[KEYS] = {2, 5, 31};
+static const uint32_t active_low = 1UL << 5; // кнопка 1 замыкает на землю
+
+struct event_log_t
+{
+    char buf[LOG_LEN];
+    size_t len;
+    bool times;
+};
+
+static char state_char(uButtonState s)
+{
+    switch (s)
+    {
+    case uButtonState::Press: return 'P';
+    case uButtonState::Click: return 'C';
+    case uButtonState::Hold: return 'H';
+    case uButtonState::ReleaseHold: return 'h';
+    case uButtonState::Step: return 'S';
+    case uButtonState::ReleaseStep: return 's';
+    case uButtonState::Release: return 'R';
+    case uButtonState::Clicks: return 'N';
+    case uButtonState::Timeout: return 'T';
+    default: return 0; // состояние ожидания, не событие
+    }
+}
+
+static void log_event(event_log_t *log, uButtonState s, uint8_t clicks, uint32_t t)
+{
+    char c = state_char(s);
+
+    if (!c)
+    {
+        return;
+    }
+    if (log->times)
+    {
+        log->len += snprintf(log->buf + log->len, LOG_LEN - log->len, "%s%c%u@%u",
+                             log->len ? " " : "", c, clicks, (unsigned)t);
+    }
+    else
+    {
+        log->len += snprintf(log->buf + log->len, LOG_LEN - log->len, "%s%c%u",
+                             log->len ? " " : "", c, clicks);
+    }
+}
+
+static bool level_at(const trace_t &tr, uint32_t t)
+{
+    bool level = false;
+
+    for (size_t i = 0; i < tr.n && tr.e[i].t <= t; i++)
+    {
+        level = tr.e[i].level;
+    }
+    return level;
+}
+
+// Значение порта: уровни кнопок с учётом активного низкого, прочие биты шумят
+static uint32_t port_at(const trace_t (&tr)[KEYS], uint32_t t)
+{
+    uint32_t raw = (t * 2654435761u) & ~((1UL << 2) | (1UL << 5) | (1UL << 31));
+
+    for (uint8_t i = 0; i < KEYS; i++)
+    {
+        if (level_at(tr[i], t))
+        {
+            raw |= 1UL << pins[i];
+        }
+    }
+    return raw ^ active_low;
+}
+
+static void replay_scan(Scan &kb, const trace_t (&tr)[KEYS], uint32_t end, event_log_t (&log)[KEYS])
+{
+    for (uint32_t t = 0; t < end; t += Scan::scanPeriod)
+    {
+        uint32_t changed = kb.scan(port_at(tr, t), t);
+
+        for (uint8_t i = 0; i < KEYS; i++)
+        {
+            TEST_ASSERT_EQUAL(kb.changed(i), (changed >> i) & 1);
+            if (kb.changed(i))
+            {
+                log_event(&log[i], kb.getState(i), kb.getClicks(i), t);
+            }
+        }
+    }
+}
+
+// Та же запись одной кнопки через uButtonT, опрос раз в 1 мс
+static void replay_poll(const trace_t &tr, uint32_t end, event_log_t *log)
+{
+    uButtonT<uButtonTimings<>, VClock> b;
+
+    for (VClock::t = 0; VClock::t < end; VClock::t++)
+    {
+        if (b.pollDebounce(level_at(tr, VClock::t)))
+        {
+            log_event(log, b.getState(), b.getClicks(), VClock::t);
+        }
+    }
+}
+
+static void check_scan(const char *const (&expected)[KEYS], const trace_t (&tr)[KEYS], uint32_t end)
+{
+    Scan kb(pins, active_low);
+    event_log_t scan_log[KEYS] = {};
+
+    for (uint8_t i = 0; i < KEYS; i++)
+    {
+        scan_log[i].times = true;
+    }
+
+    replay_scan(kb, tr, end, scan_log);
+    TEST_ASSERT_FALSE(kb.busy());
+    TEST_ASSERT_EQUAL_UINT32(0, kb.pressedMask());
+
+    for (uint8_t i = 0; i < KEYS; i++)
+    {
+        event_log_t scan_seq = {{0}, 0, false};
+        event_log_t poll_seq = {{0}, 0, false};
+        const char *p = expected[i];
+
+        TEST_ASSERT_EQUAL_STRING(expected[i], scan_log[i].buf);
+
+        while (*p)
+        {
+            const char *at = strchr(p, '@');
+            const char *next = strchr(p, ' ');
+
+            scan_seq.len += snprintf(scan_seq.buf + scan_seq.len, LOG_LEN - scan_seq.len, "%s%.*s",
+                                     scan_seq.len ? " " : "", (int)(at - p), p);
+            p = next ? next + 1 : p + strlen(p);
+        }
+
+        replay_poll(tr[i], end, &poll_seq);
+        TEST_ASSERT_EQUAL_STRING(scan_seq.buf, poll_seq.buf);
+    }
+}
+
+void setUp(void)
+{
+    VClock::t = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Три кнопки одновременно: клик, двойной клик (активный низкий), удержание
+static void test_three_keys(void)
+{
+    static const edge_t click[] = {{100, 1}, {300, 0}};
+    static const edge_t dbl[] = {{110, 1}, {230, 0}, {350, 1}, {470, 0}};
+    static const edge_t hold[] = {{120, 1}, {2700, 0}};
+    static const trace_t tr[KEYS] = {{click, 2}, {dbl, 4}, {hold, 2}};
+    static const char *const expected[KEYS] = {
+        "P0@144 C1@336 R1@348 N1@864 T0@1872",
+        "P0@156 C1@276 R1@288 P1@396 C2@516 R2@528 N2@1044 T0@2052",
+        "P0@156 H0@1176 S0@1584 S0@2592 s0@2736 R0@2748 T0@3768",
+    };
+
+    check_scan(expected, tr, 5000);
+}
+
+// Дребезг короче четырёх сканов не даёт событий ни одной кнопке
+static void test_bounce_filtered(void)
+{
+    static const edge_t k0[] = {{100, 1}, {120, 0}, {140, 1}, {160, 0}, {600, 1}, {800, 0}};
+    static const edge_t k1[] = {{96, 1}, {130, 0}};
+    static const edge_t none[] = {{0, 0}};
+    static const trace_t tr[KEYS] = {{k0, 6}, {k1, 2}, {none, 1}};
+    static const char *const expected[KEYS] = {
+        "P0@636 C1@840 R1@852 N1@1368 T0@2376",
+        "",
+        "",
+    };
+
+    check_scan(expected, tr, 3000);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_three_keys);
+    RUN_TEST(test_bounce_filtered);
+    return UNITY_END();
+}
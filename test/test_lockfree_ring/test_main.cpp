@@ -0,0 +1,176 @@
+/*
+ * Lock-free кольца (src/lockfree_ring.h) на хосте: граничные случаи в одном
+ * потоке и нагрузка настоящими потоками. MPSC - несколько производителей на
+ * маленьком кольце, чтобы оно постоянно было полным: ни один элемент не
+ * теряется и не дублируется, порядок каждого производителя сохраняется.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "lockfree_ring.h"
+
+#define PRODUCERS 4
+#define ITEMS 200000u
+
+struct item_t
+{
+    uint32_t producer;
+    uint32_t seq;
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_spsc_full_empty(void)
+{
+    static SpscRing<uint32_t, 4> r;
+    uint32_t v;
+
+    TEST_ASSERT_FALSE(r.pop(v));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(r.push(i));
+    }
+    TEST_ASSERT_FALSE(r.push(4));
+    TEST_ASSERT_EQUAL_UINT32(4, r.count());
+
+    // Несколько кругов по кольцу: индексы переходят через N
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(r.pop(v));
+        TEST_ASSERT_EQUAL_UINT32(i, v);
+        TEST_ASSERT_TRUE(r.push(i + 4));
+    }
+}
+
+static void test_mpsc_full_empty(void)
+{
+    static MpscRing<uint32_t, 4> r;
+    uint32_t v;
+
+    TEST_ASSERT_FALSE(r.pop(v));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(r.push(i));
+    }
+    TEST_ASSERT_FALSE(r.push(4));
+
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(r.pop(v));
+        TEST_ASSERT_EQUAL_UINT32(i, v);
+        TEST_ASSERT_TRUE(r.push(i + 4));
+    }
+}
+
+static void test_mpsc_stress(void)
+{
+    static MpscRing<item_t, 16> r;
+    std::vector<std::thread> producers;
+    uint32_t next[PRODUCERS] = {0};
+    uint32_t got = 0;
+    uint32_t bad = 0;
+    item_t it;
+
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([p] {
+            for (uint32_t i = 0; i < ITEMS;)
+            {
+                if (r.push({p, i}))
+                {
+                    i++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    while (got < PRODUCERS * ITEMS)
+    {
+        if (!r.pop(it))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (it.producer >= PRODUCERS || it.seq != next[it.producer])
+        {
+            bad++;
+        }
+        else
+        {
+            next[it.producer]++;
+        }
+        got++;
+    }
+
+    for (std::thread &t : producers)
+    {
+        t.join();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, bad);
+    TEST_ASSERT_FALSE(r.pop(it));
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(ITEMS, next[p]);
+    }
+}
+
+static void test_spsc_stress(void)
+{
+    static SpscRing<uint32_t, 8> r;
+    uint32_t expected = 0;
+    uint32_t bad = 0;
+    uint32_t v;
+
+    std::thread producer([] {
+        for (uint32_t i = 0; i < 2 * ITEMS;)
+        {
+            if (r.push(i))
+            {
+                i++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    while (expected < 2 * ITEMS)
+    {
+        if (!r.pop(v))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        bad += v != expected;
+        expected++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, bad);
+    TEST_ASSERT_EQUAL_UINT32(0, r.count());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_full_empty);
+    RUN_TEST(test_mpsc_full_empty);
+    RUN_TEST(test_mpsc_stress);
+    RUN_TEST(test_spsc_stress);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+/*
+ * ПИ-регулятор (src/pi_ctrl.h) на хосте: объект - звено первого порядка
+ * с насыщением, как мотор у регулятора скорости (speed_ctrl.c): выход
+ * duty16, измерение - об/мин. Плюс замер времени одного шага.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pi_ctrl.h"
+
+// Те же коэффициенты и ограничение, что в speed_ctrl.c (шаг 10 мс)
+#define KP PI_GAIN(2.0)
+#define KI PI_GAIN(20.0 * 10000 / 1000000)
+#define OUT_MAX 62258 // 95% duty16
+
+#define PLANT_DUTY_PER_RPM 16 // установившаяся скорость = duty16 / 16
+#define PLANT_TAU_STEPS 8     // постоянная времени, шагов
+
+#define BENCH_STEPS 10000000u
+
+static pi_ctrl_t pi;
+
+static int32_t plant_step(int32_t rpm, int32_t out)
+{
+    return rpm + (out / PLANT_DUTY_PER_RPM - rpm) / PLANT_TAU_STEPS;
+}
+
+void setUp(void)
+{
+    pi_ctrl_init(&pi, KP, KI, 0, OUT_MAX);
+}
+
+void tearDown(void)
+{
+}
+
+// Ступенька уставки: выход в пределах, скорость приходит к уставке и держится
+static void test_step_response(void)
+{
+    int32_t rpm = 0;
+    int32_t peak = 0;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        int32_t out = pi_ctrl_update(&pi, 2000, rpm);
+
+        TEST_ASSERT_TRUE(out >= 0 && out <= OUT_MAX);
+        rpm = plant_step(rpm, out);
+        peak = rpm > peak ? rpm : peak;
+        if (i >= 600)
+        {
+            TEST_ASSERT_INT32_WITHIN(20, 2000, rpm);
+        }
+    }
+
+    // Перерегулирование не больше 25%
+    TEST_ASSERT_TRUE(peak <= 2500);
+}
+
+// Выход не выходит за out_min/out_max при любой ошибке
+static void test_output_clamped(void)
+{
+    TEST_ASSERT_EQUAL_INT32(OUT_MAX, pi_ctrl_update(&pi, 100000, 0));
+    TEST_ASSERT_EQUAL_INT32(OUT_MAX, pi_ctrl_update(&pi, INT32_MAX / 4, 0));
+    TEST_ASSERT_EQUAL_INT32(0, pi_ctrl_update(&pi, 0, 100000));
+    TEST_ASSERT_EQUAL_INT32(0, pi_ctrl_update(&pi, 0, INT32_MAX / 4));
+}
+
+// В насыщении интеграл не растёт, и регулятор сразу выходит из него
+static void test_anti_windup(void)
+{
+    int32_t integ;
+    int32_t out;
+    int steps = 0;
+
+    // Уставка недостижима: мотор заторможен, скорость 0. Интеграл растёт,
+    // пока выход не упрётся в OUT_MAX
+    do
+    {
+        out = pi_ctrl_update(&pi, 6000, 0);
+        TEST_ASSERT_TRUE(++steps < 1000);
+    } while (out < OUT_MAX);
+    integ = pi.integ;
+
+    // Интеграл не дальше одного шага за границей насыщения (P = 12000, шаг I = 1200)
+    TEST_ASSERT_TRUE((integ >> PI_INTEG_Q) <= OUT_MAX - 12000 + 1200);
+
+    for (int i = 0; i < 10000; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(OUT_MAX, pi_ctrl_update(&pi, 6000, 0));
+        TEST_ASSERT_TRUE(pi.integ <= integ);
+        integ = pi.integ;
+    }
+    TEST_ASSERT_TRUE(pi.integ <= OUT_MAX * (1 << PI_INTEG_Q));
+
+    // Уставка ниже измерения: выход уходит из насыщения за один шаг
+    out = pi_ctrl_update(&pi, 1000, 1500);
+    TEST_ASSERT_TRUE(out < OUT_MAX - 10000);
+
+    // И снизу: долгий ноль не копит отрицательный интеграл
+    pi_ctrl_reset(&pi, 0);
+    for (int i = 0; i < 10000; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(0, pi_ctrl_update(&pi, 0, 3000));
+        TEST_ASSERT_TRUE(pi.integ >= 0);
+    }
+    TEST_ASSERT_TRUE(pi_ctrl_update(&pi, 1000, 0) > 0);
+}
+
+// Безударный старт: при нулевой ошибке выход равен переданному в reset
+static void test_reset_bumpless(void)
+{
+    pi_ctrl_reset(&pi, 20000);
+    TEST_ASSERT_EQUAL_INT32(20000, pi.out);
+    TEST_ASSERT_EQUAL_INT32(20000, pi_ctrl_update(&pi, 1250, 1250));
+    TEST_ASSERT_EQUAL_INT32(20000, pi_ctrl_update(&pi, 1250, 1250));
+
+    // Небольшая ошибка - небольшой шаг от текущего выхода, а не от нуля
+    int32_t out = pi_ctrl_update(&pi, 1260, 1250);
+    TEST_ASSERT_INT32_WITHIN(30, 20000, out);
+
+    // Значение вне диапазона ограничивается
+    pi_ctrl_reset(&pi, OUT_MAX + 1000);
+    TEST_ASSERT_EQUAL_INT32(OUT_MAX, pi.out);
+    TEST_ASSERT_EQUAL_INT32(OUT_MAX, pi_ctrl_update(&pi, 0, 0));
+    pi_ctrl_reset(&pi, -5);
+    TEST_ASSERT_EQUAL_INT32(0, pi_ctrl_update(&pi, 0, 0));
+}
+
+// Время одного шага на хосте (для сравнения между версиями, не предел)
+static void test_update_timing(void)
+{
+    clock_t t0, t1;
+    volatile int32_t measured = 1000;
+    int64_t sum = 0;
+
+    t0 = clock();
+    for (uint32_t i = 0; i < BENCH_STEPS; i++)
+    {
+        int32_t out = pi_ctrl_update(&pi, 2000, measured);
+
+        sum += out;
+        measured = 1000 + (out >> 8) - (int32_t)(i & 255);
+    }
+    t1 = clock();
+
+    double ns = (double)(t1 - t0) * 1e9 / CLOCKS_PER_SEC / BENCH_STEPS;
+    printf("pi_ctrl_update: %.2f ns/step (%u steps)\n", ns, BENCH_STEPS);
+
+    TEST_ASSERT_TRUE(sum > 0);
+    TEST_ASSERT_TRUE(pi.out >= 0 && pi.out <= OUT_MAX);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_step_response);
+    RUN_TEST(test_output_clamped);
+    RUN_TEST(test_anti_windup);
+    RUN_TEST(test_reset_bumpless);
+    RUN_TEST(test_update_timing);
+    return UNITY_END();
+}
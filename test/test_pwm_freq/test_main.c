@@ -0,0 +1,118 @@
+/*
+ * Подбор PRESCALER/COUNTERTOP (src/pwm_freq.h): опорные точки
+ * PWM_FREQ_TABLE, границы диапазона и свойства на всём диапазоне частот.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pwm_freq.h"
+
+typedef struct
+{
+    uint32_t hz;
+    uint8_t prescaler;
+    uint16_t countertop;
+    uint8_t bits;
+} freq_row_t;
+
+#define FREQ_ROW(hz, prescaler, top, bits) {(hz), (prescaler), (top), (bits)},
+static const freq_row_t rows[] = {PWM_FREQ_TABLE(FREQ_ROW)};
+#undef FREQ_ROW
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_table_rows(void)
+{
+    TEST_ASSERT_EQUAL(8, sizeof(rows) / sizeof(rows[0]));
+
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++)
+    {
+        pwm_freq_cfg_t cfg;
+
+        TEST_ASSERT_TRUE(pwm_freq_calc(rows[i].hz, &cfg));
+        TEST_ASSERT_EQUAL_UINT8(rows[i].prescaler, cfg.prescaler);
+        TEST_ASSERT_EQUAL_UINT16(rows[i].countertop, cfg.countertop);
+        TEST_ASSERT_EQUAL_UINT8(rows[i].bits, cfg.bits);
+        // Все опорные точки делятся нацело
+        TEST_ASSERT_EQUAL_UINT32(rows[i].hz, cfg.actual_hz);
+        TEST_ASSERT_EQUAL_UINT32(1000000000u / rows[i].hz, cfg.period_ns);
+    }
+}
+
+// 100 Гц: DIV_1..DIV_4 дают COUNTERTOP больше 15 бит, первый подходящий - DIV_8
+static void test_100hz(void)
+{
+    pwm_freq_cfg_t cfg;
+
+    TEST_ASSERT_TRUE(pwm_freq_calc(100, &cfg));
+    TEST_ASSERT_EQUAL_UINT8(3, cfg.prescaler);
+    TEST_ASSERT_EQUAL_UINT16(20000, cfg.countertop);
+    TEST_ASSERT_EQUAL_UINT8(14, cfg.bits);
+    TEST_ASSERT_EQUAL_UINT32(10000000, cfg.period_ns);
+}
+
+static void test_limits(void)
+{
+    pwm_freq_cfg_t cfg;
+
+    TEST_ASSERT_FALSE(pwm_freq_calc(0, &cfg));
+    TEST_ASSERT_FALSE(pwm_freq_calc(PWM_FREQ_MIN_HZ - 1, &cfg));
+    TEST_ASSERT_FALSE(pwm_freq_calc(PWM_FREQ_MAX_HZ + 1, &cfg));
+    TEST_ASSERT_FALSE(pwm_freq_calc(UINT32_MAX, &cfg));
+
+    TEST_ASSERT_TRUE(pwm_freq_calc(PWM_FREQ_MIN_HZ, &cfg));
+    TEST_ASSERT_EQUAL_UINT32(PWM_FREQ_MIN_HZ, cfg.actual_hz);
+
+    TEST_ASSERT_TRUE(pwm_freq_calc(PWM_FREQ_MAX_HZ, &cfg));
+    TEST_ASSERT_EQUAL_UINT8(0, cfg.prescaler);
+    TEST_ASSERT_EQUAL_UINT16(PWM_FREQ_TOP_MIN, cfg.countertop);
+    TEST_ASSERT_EQUAL_UINT32(PWM_FREQ_MAX_HZ, cfg.actual_hz);
+}
+
+// Весь диапазон: наименьший делитель, COUNTERTOP в пределах и отличается
+// от точного не больше чем на отсчёт
+static void test_range(void)
+{
+    for (uint32_t hz = PWM_FREQ_MIN_HZ; hz <= PWM_FREQ_MAX_HZ; hz += 7)
+    {
+        pwm_freq_cfg_t cfg;
+        char where[32];
+
+        snprintf(where, sizeof(where), "%u Hz", (unsigned)hz);
+        TEST_ASSERT_TRUE_MESSAGE(pwm_freq_calc(hz, &cfg), where);
+        TEST_ASSERT_TRUE_MESSAGE(cfg.countertop >= PWM_FREQ_TOP_MIN && cfg.countertop <= PWM_FREQ_TOP_MAX,
+                                 where);
+        TEST_ASSERT_TRUE_MESSAGE(cfg.prescaler <= PWM_FREQ_PRESCALER_MAX, where);
+        TEST_ASSERT_TRUE_MESSAGE(cfg.bits == pwm_freq_bits(cfg.countertop), where);
+
+        // Меньший делитель дал бы COUNTERTOP больше 15 бит
+        if (cfg.prescaler > 0)
+        {
+            uint32_t clk = PWM_FREQ_BASE_HZ >> (cfg.prescaler - 1);
+            TEST_ASSERT_TRUE_MESSAGE((clk + hz / 2) / hz > PWM_FREQ_TOP_MAX, where);
+        }
+
+        uint32_t clk = PWM_FREQ_BASE_HZ >> cfg.prescaler;
+        uint32_t lo = clk / (cfg.countertop + 1);
+        uint32_t hi = clk / (cfg.countertop - 1);
+        TEST_ASSERT_TRUE_MESSAGE(hz >= lo && hz <= hi, where);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_table_rows);
+    RUN_TEST(test_100hz);
+    RUN_TEST(test_limits);
+    RUN_TEST(test_range);
+    return UNITY_END();
+}
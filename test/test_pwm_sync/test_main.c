@@ -0,0 +1,200 @@
+/*
+ * Моменты выборки SAADC относительно периода ШИМ (src/pwm_sync.h) на сетке
+ * частота x скважность. Параметры скана те же, что в adc_sync_calc()
+ * (adc.c): ток TACQ 3 мкс, ЭДС TACQ 10 мкс, преобразование 2 мкс, гашение 2 мкс.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pwm_sync.h"
+
+#define TACQ_CURRENT_US 3
+#define TACQ_BEMF_US 10
+#define CONV_US 2
+#define BLANK_US 2
+
+static const uint32_t freqs_hz[] = {100, 500, 1000, 4000, 10000, 20000, 25000, 29000, 40000};
+
+static pwm_sync_params_t params(uint32_t period, uint32_t pulse)
+{
+    pwm_sync_params_t p = {
+        .period = period,
+        .pulse = pulse,
+        .on_lead = 0,
+        .on_acq = PWM_SYNC_US_TO_TICKS(TACQ_CURRENT_US),
+        .off_lead = PWM_SYNC_US_TO_TICKS(TACQ_CURRENT_US + CONV_US),
+        .off_acq = PWM_SYNC_US_TO_TICKS(TACQ_BEMF_US),
+        .scan = PWM_SYNC_US_TO_TICKS(TACQ_CURRENT_US + CONV_US + TACQ_BEMF_US + CONV_US),
+        .blank = PWM_SYNC_US_TO_TICKS(BLANK_US),
+    };
+    return p;
+}
+
+static uint32_t period_ticks(uint32_t hz)
+{
+    return PWM_SYNC_CLOCK_HZ / hz;
+}
+
+// Общие свойства любой раскладки
+static void check_timing(const pwm_sync_params_t *p, const pwm_sync_timing_t *t)
+{
+    char where[64];
+    snprintf(where, sizeof(where), "period %u pulse %u", (unsigned)p->period, (unsigned)p->pulse);
+
+    TEST_ASSERT_TRUE_MESSAGE(t->on_cc >= PWM_SYNC_MIN_CC, where);
+    TEST_ASSERT_TRUE_MESSAGE(t->off_cc >= PWM_SYNC_MIN_CC, where);
+    TEST_ASSERT_EQUAL_MESSAGE(p->period >= 2 * p->scan, t->feasible, where);
+
+    if (!t->feasible)
+    {
+        TEST_ASSERT_FALSE_MESSAGE(t->on_valid || t->off_valid, where);
+        return;
+    }
+
+    // Порядок и конец сканов постоянны: раскладка DMA буфера не меняется
+    TEST_ASSERT_TRUE_MESSAGE(t->off_cc >= t->on_cc + p->scan, where);
+    TEST_ASSERT_TRUE_MESSAGE(t->off_cc + p->scan <= p->period, where);
+
+    // Отсчёт достоверен - окно TACQ внутри своего состояния за вычетом гашения
+    if (t->on_valid)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(t->on_cc + p->on_lead >= p->blank, where);
+        TEST_ASSERT_TRUE_MESSAGE(t->on_cc + p->on_lead + p->on_acq + p->blank <= p->pulse, where);
+    }
+    if (t->off_valid)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(t->off_cc + p->off_lead >= p->pulse + p->blank, where);
+        TEST_ASSERT_TRUE_MESSAGE(t->off_cc + p->off_lead + p->off_acq + p->blank <= p->period, where);
+    }
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Сетка частота x скважность 0-100% шагом 1%
+static void test_grid(void)
+{
+    for (size_t f = 0; f < sizeof(freqs_hz) / sizeof(freqs_hz[0]); f++)
+    {
+        uint32_t period = period_ticks(freqs_hz[f]);
+
+        for (uint32_t pct = 0; pct <= 100; pct++)
+        {
+            pwm_sync_params_t p = params(period, period * pct / 100);
+            pwm_sync_timing_t t = pwm_sync_calc(&p);
+
+            check_timing(&p, &t);
+        }
+    }
+}
+
+// Широкие состояния: отсчёт точно в середине и достоверен
+static void test_centered(void)
+{
+    uint32_t period = period_ticks(1000);
+    pwm_sync_params_t p = params(period, period / 2);
+    pwm_sync_timing_t t = pwm_sync_calc(&p);
+    uint32_t on_mid = t.on_cc + p.on_lead + p.on_acq / 2;
+    uint32_t off_mid = t.off_cc + p.off_lead + p.off_acq / 2;
+
+    TEST_ASSERT_TRUE(t.on_valid);
+    TEST_ASSERT_TRUE(t.off_valid);
+    TEST_ASSERT_EQUAL_UINT32(p.pulse / 2, on_mid);
+    TEST_ASSERT_EQUAL_UINT32(p.pulse + (period - p.pulse) / 2, off_mid);
+
+    // На всей сетке: если состояние шире двух сканов, отсчёт в нём достоверен
+    for (size_t f = 0; f < sizeof(freqs_hz) / sizeof(freqs_hz[0]); f++)
+    {
+        period = period_ticks(freqs_hz[f]);
+        for (uint32_t pct = 0; pct <= 100; pct++)
+        {
+            p = params(period, period * pct / 100);
+            t = pwm_sync_calc(&p);
+            if (!t.feasible)
+            {
+                continue;
+            }
+            if (p.pulse >= 2 * p.scan && period - p.pulse >= 2 * p.scan)
+            {
+                TEST_ASSERT_TRUE(t.on_valid);
+                TEST_ASSERT_TRUE(t.off_valid);
+            }
+        }
+    }
+}
+
+// 0%: включённого состояния нет, ЭДС в середине периода
+static void test_duty_zero(void)
+{
+    for (size_t f = 0; f < sizeof(freqs_hz) / sizeof(freqs_hz[0]); f++)
+    {
+        pwm_sync_params_t p = params(period_ticks(freqs_hz[f]), 0);
+        pwm_sync_timing_t t = pwm_sync_calc(&p);
+
+        check_timing(&p, &t);
+        TEST_ASSERT_FALSE(t.on_valid);
+        TEST_ASSERT_EQUAL_UINT32(PWM_SYNC_MIN_CC, t.on_cc);
+        TEST_ASSERT_EQUAL(t.feasible, t.off_valid);
+    }
+}
+
+// 100% (и pulse больше периода): выключенного состояния нет
+static void test_duty_full(void)
+{
+    for (size_t f = 0; f < sizeof(freqs_hz) / sizeof(freqs_hz[0]); f++)
+    {
+        uint32_t period = period_ticks(freqs_hz[f]);
+        pwm_sync_params_t p = params(period, period);
+        pwm_sync_timing_t t = pwm_sync_calc(&p);
+
+        check_timing(&p, &t);
+        TEST_ASSERT_FALSE(t.off_valid);
+        // Скан ЭДС и здесь стоит после скана тока, поэтому отсчёт тока
+        // гарантированно достоверен, если период вмещает четыре скана
+        if (period >= 4 * p.scan)
+        {
+            TEST_ASSERT_TRUE(t.on_valid);
+        }
+
+        p.pulse = period + 100;
+        t = pwm_sync_calc(&p);
+        TEST_ASSERT_FALSE(t.off_valid);
+        TEST_ASSERT_TRUE(t.off_cc + p.scan <= period || !t.feasible);
+    }
+}
+
+// Короткий импульс: середина раньше начала окна, CC не меньше PWM_SYNC_MIN_CC
+static void test_min_cc(void)
+{
+    pwm_sync_params_t p = params(period_ticks(1000), 4);
+    pwm_sync_timing_t t = pwm_sync_calc(&p);
+
+    TEST_ASSERT_EQUAL_UINT32(PWM_SYNC_MIN_CC, t.on_cc);
+    TEST_ASSERT_FALSE(t.on_valid);
+    TEST_ASSERT_TRUE(t.off_valid);
+    check_timing(&p, &t);
+
+    // Период короче двух сканов: раскладка невозможна, CC всё равно >= MIN_CC
+    p = params(p.scan, p.scan / 2);
+    t = pwm_sync_calc(&p);
+    TEST_ASSERT_FALSE(t.feasible);
+    check_timing(&p, &t);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_grid);
+    RUN_TEST(test_centered);
+    RUN_TEST(test_duty_zero);
+    RUN_TEST(test_duty_full);
+    RUN_TEST(test_min_cc);
+    return UNITY_END();
+}
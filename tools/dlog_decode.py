@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Декодер отложенного лога (src/dlog.c, DLOG_OUTPUT_BINARY).
+
+Поток из RTT канала 2 - записи из 32-битных слов little-endian:
+  [level << 28 | nargs << 24 | адрес строки формата][k_cycle_get_32()][аргументы...]
+Строки формата берутся из ELF прошивки по адресу.
+
+  JLinkRTTLogger -Device NRF52840_XXAA -RTTChannel 2 dlog.bin
+  python3 tools/dlog_decode.py .pio/build/<env>/firmware.elf dlog.bin
+
+Нужен pyelftools (pip install pyelftools).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+ADDR_MASK = 0x00FFFFFF
+LEVELS = "?EWID"
+CONV = re.compile(r"%([-+ #0]*)(\d+)?(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcp%])")
+
+
+class Strings:
+    def __init__(self, path):
+        self.segments = []
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for seg in elf.iter_segments():
+                if seg["p_type"] == "PT_LOAD" and seg["p_filesz"]:
+                    self.segments.append((seg["p_vaddr"], seg.data()))
+
+    def get(self, addr):
+        for base, data in self.segments:
+            if base <= addr < base + len(data):
+                end = data.find(b"\0", addr - base)
+                return data[addr - base:end].decode("utf-8", "replace")
+        return None
+
+
+def c_format(fmt, args):
+    """printf-подмножество: целые 32 бита, как их форматирует printk"""
+    it = iter(args)
+
+    def repl(m):
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            return "%"
+        v = next(it, 0)
+        if conv in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            conv = "d"
+        elif conv == "c":
+            return chr(v & 0xFF)
+        elif conv == "p":
+            return "0x%08x" % v
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "") + conv
+        return spec % v
+
+    return CONV.sub(repl, fmt)
+
+
+def decode(stream, strings, clock_hz):
+    while True:
+        hdr = stream.read(8)
+        if len(hdr) < 8:
+            return
+        word, ts = struct.unpack("<II", hdr)
+        nargs = (word >> 24) & 0x0F
+        args = struct.unpack("<%dI" % nargs, stream.read(4 * nargs))
+        fmt = strings.get(word & ADDR_MASK)
+        level = LEVELS[word >> 28] if (word >> 28) < len(LEVELS) else "?"
+        if fmt is None:
+            text = "<unknown fmt 0x%06x> %s\n" % (word & ADDR_MASK, " ".join(hex(a) for a in args))
+        else:
+            text = c_format(fmt, args)
+        yield "[%10.3f %s] %s" % (ts / clock_hz, level, text.rstrip("\n") + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf", help="ELF прошивки, из которой снят лог")
+    ap.add_argument("log", nargs="?", help="дамп RTT канала (по умолчанию stdin)")
+    ap.add_argument("--clock", type=int, default=32768, help="частота k_cycle_get_32(), Гц")
+    a = ap.parse_args()
+
+    strings = Strings(a.elf)
+    stream = open(a.log, "rb") if a.log else sys.stdin.buffer
+    for line in decode(stream, strings, a.clock):
+        sys.stdout.write(line)
+
+
+if __name__ == "__main__":
+    main()
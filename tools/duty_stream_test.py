@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Тестовый клиент потока уставок (src/duty_stream.cpp, характеристика 0xABD8).
+
+Шлёт синус скважности пакетами записи без ответа с метками времени,
+раз в секунду читает счётчики джиттер-буфера:
+  пакет: <HIH seq, t_us, period_us> + N x duty16 LE
+  счётчики: <IIHHHHHHII batches, samples, lost, late, gap_filled,
+            overruns, underruns, depth_min, jitter_max_us, jitter_avg_us
+
+  python3 tools/duty_stream_test.py Motor_Controller --rate 100 --batch 4 --time 30
+
+Нужен bleak (pip install bleak).
+"""
+
+import argparse
+import asyncio
+import math
+import struct
+import time
+
+from bleak import BleakClient, BleakScanner
+
+STREAM_UUID = "0000abd8-0000-1000-8000-00805f9b34fb"
+HDR = struct.Struct("<HIH")
+STATS = struct.Struct("<IIHHHHHHII")
+STATS_NAMES = ["batches", "samples", "lost", "late", "gap_filled",
+               "overruns", "underruns", "depth_min", "jitter_max_us", "jitter_avg_us"]
+
+
+async def run(args):
+    dev = await BleakScanner.find_device_by_name(args.name, timeout=10)
+    if dev is None:
+        raise SystemExit(f"{args.name}: not found")
+
+    period_us = 1000000 // args.rate
+    async with BleakClient(dev) as client:
+        t0 = time.monotonic_ns() // 1000
+        seq = 0
+        n = 0
+        next_report = time.monotonic() + 1
+        end = time.monotonic() + args.time
+
+        while time.monotonic() < end:
+            t_us = n * period_us
+            duty = [int((0.5 + 0.5 * args.depth * math.sin(2 * math.pi * args.freq * (n + i) * period_us / 1e6))
+                        * 65535) for i in range(args.batch)]
+            pkt = HDR.pack(seq & 0xFFFF, t_us & 0xFFFFFFFF, period_us) + struct.pack(f"<{args.batch}H", *duty)
+            await client.write_gatt_char(STREAM_UUID, pkt, response=False)
+            seq += 1
+            n += args.batch
+
+            # Следующий пакет - когда у отправителя наберутся его отсчёты
+            wait_us = t0 + n * period_us - time.monotonic_ns() // 1000
+            if wait_us > 0:
+                await asyncio.sleep(wait_us / 1e6)
+
+            if time.monotonic() >= next_report:
+                next_report += 1
+                stats = STATS.unpack(await client.read_gatt_char(STREAM_UUID))
+                print(" ".join(f"{k}={v}" for k, v in zip(STATS_NAMES, stats)))
+
+        # Пакет без отсчётов - конец потока
+        await client.write_gatt_char(STREAM_UUID, HDR.pack(seq & 0xFFFF, (n * period_us) & 0xFFFFFFFF, period_us),
+                                     response=False)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("name", help="имя устройства (CONFIG_BT_DEVICE_NAME)")
+    ap.add_argument("--rate", type=int, default=100, help="отсчётов в секунду, 50-200")
+    ap.add_argument("--batch", type=int, default=4, help="отсчётов в пакете")
+    ap.add_argument("--freq", type=float, default=1.0, help="частота синуса, Гц")
+    ap.add_argument("--depth", type=float, default=0.5, help="размах синуса, доля")
+    ap.add_argument("--time", type=float, default=30, help="длительность, с")
+    run_args = ap.parse_args()
+    asyncio.run(run(run_args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Декодер журнала телеметрии (src/telemetry.c, характеристика 0xABD4).
+
+Поток - блоки по 256 байт (последний может быть короче):
+  заголовок <HBBIIHHBBH: magic, count, len, seq, t0_s, period_s, vbat_mv, duty, flags, crc16
+  записи: varint(zigzag(dVbat)) varint(zigzag(dDuty)) varint(мотор, с) varint(faults)
+
+  python3 tools/telem_decode.py telemetry.bin > telemetry.csv
+"""
+
+import argparse
+import struct
+import sys
+
+BLOCK_SIZE = 256
+HDR = struct.Struct("<HBBIIHHBBH")
+MAGIC = 0x4C54
+FAULTS = ["adc_overrun", "speed_overrun", "speed_no_feedback", "log_dropped"]
+
+
+# Как crc16_ccitt() в Zephyr: полином 0x1021, отражённый (вариант KERMIT)
+def crc16_ccitt(data, crc=0):
+    for b in data:
+        e = (crc ^ b) & 0xFF
+        f = (e ^ (e << 4)) & 0xFF
+        crc = (crc >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)
+    return crc & 0xFFFF
+
+
+def varints(data):
+    v = shift = 0
+    for b in data:
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            yield v
+            v = shift = 0
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode(stream, out):
+    out.write("seq,boot,t_s,vbat_mv,duty,motor_s,faults\n")
+    for pos in range(0, len(stream), BLOCK_SIZE):
+        blk = stream[pos:pos + BLOCK_SIZE]
+        if len(blk) < HDR.size:
+            break
+        magic, count, length, seq, t0, period, vbat, duty, flags, crc = HDR.unpack_from(blk)
+        payload = blk[HDR.size:HDR.size + length]
+        if magic != MAGIC or len(payload) != length or crc16_ccitt(payload) != crc:
+            print(f"block at {pos}: bad header or crc, skipped", file=sys.stderr)
+            continue
+
+        vals = list(varints(payload))
+        for i in range(min(count, len(vals) // 4)):
+            dv, dd, run, faults = vals[i * 4:i * 4 + 4]
+            vbat += unzigzag(dv)
+            duty += unzigzag(dd)
+            names = "|".join(n for b, n in enumerate(FAULTS) if faults & (1 << b))
+            out.write(f"{seq},{flags & 1},{t0 + i * period},{vbat},{duty},{run},{names}\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("dump", help="содержимое характеристики 0xABD4")
+    args = ap.parse_args()
+
+    with open(args.dump, "rb") as f:
+        decode(f.read(), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()